@@ -4,9 +4,74 @@ in vec2 fragTexcoord;
 
 out vec4 outColor;
 
+// VRAM in RGB5A1, possibly upscaled (size is multiple of 1024x512)
 uniform sampler2D renderBuffer;
 
+uniform bool filtering;
+
+// Display area holds packed RGB888 pixels (MDEC output), displayStart is in VRAM halfwords
+uniform bool colorDepth24;
+uniform ivec2 displayStart;
+
+ivec2 wrap(ivec2 pos, ivec2 size)
+{
+	return ((pos % size) + size) % size;
+}
+
+// Raw 16 bit value, RGB5A1 holds it without loss
+int readVram(ivec2 pos)
+{
+	ivec2 size = textureSize(renderBuffer, 0);
+	int scale = size.x / 1024;
+	vec4 c = texelFetch(renderBuffer, wrap(pos, ivec2(1024, 512)) * scale, 0);
+	ivec4 i = ivec4(round(c * vec4(31.0, 31.0, 31.0, 1.0)));
+	return i.r | (i.g << 5) | (i.b << 10) | (i.a << 15);
+}
+
+vec3 pixel24(ivec2 p)
+{
+	// Every pixel takes 3 bytes, so it straddles two halfwords
+	int address = displayStart.x * 2 + p.x * 3;
+	int w0 = readVram(ivec2(address >> 1, p.y));
+	int w1 = readVram(ivec2((address >> 1) + 1, p.y));
+
+	ivec3 c;
+	if ((address & 1) == 0) {
+		c = ivec3(w0 & 0xff, (w0 >> 8) & 0xff, w1 & 0xff);
+	} else {
+		c = ivec3((w0 >> 8) & 0xff, w1 & 0xff, (w1 >> 8) & 0xff);
+	}
+	return vec3(c) / 255.0;
+}
+
+vec3 pixel(ivec2 p)
+{
+	if (colorDepth24) return pixel24(p);
+
+	ivec2 size = textureSize(renderBuffer, 0);
+	return texelFetch(renderBuffer, wrap(p, size), 0).rgb;
+}
+
 void main()
 {
-	outColor = vec4(texture(renderBuffer, fragTexcoord).rgb, 1.0);
-}
\ No newline at end of file
+	// 24 bit mode is decoded in output pixels (native resolution), 15 bit mode in texels of (upscaled) VRAM
+	vec2 coord;
+	if (colorDepth24) {
+		coord = fragTexcoord * vec2(1024.0, 512.0) - vec2(float(displayStart.x), 0.0);
+	} else {
+		coord = fragTexcoord * vec2(textureSize(renderBuffer, 0));
+	}
+
+	vec3 color;
+	if (filtering) {
+		vec2 c = coord - 0.5;
+		ivec2 base = ivec2(floor(c));
+		vec2 f = fract(c);
+		color = mix(mix(pixel(base), pixel(base + ivec2(1, 0)), f.x),
+		            mix(pixel(base + ivec2(0, 1)), pixel(base + ivec2(1, 1)), f.x), f.y);
+	} else {
+		color = pixel(ivec2(floor(coord)));
+	}
+
+	outColor = vec4(color, 1.0);
+}
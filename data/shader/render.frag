@@ -0,0 +1,91 @@
+#version 150
+
+in vec3 fragColor;
+in vec2 fragTexcoord;
+flat in int fragBitcount;
+flat in ivec2 fragClut;
+flat in ivec2 fragTexpage;
+flat in int fragFlags;
+flat in ivec4 fragTextureWindow;
+
+out vec4 outColor;
+
+uniform sampler2D vram;
+
+// 0 - everything opaque, 1 - opaque texels only, 2 - semi-transparent texels and untextured primitives
+uniform int pass;
+
+const int SemiTransparency = 1 << 0;
+const int RawTexture = 1 << 1;
+const int Dithering = 1 << 2;
+
+const int ditherTable[16] = int[16](
+	-4, +0, -3, +1,
+	+2, -2, +3, -1,
+	-3, +1, -4, +0,
+	+3, -1, +2, -2
+);
+
+int readVram(ivec2 pos)
+{
+	vec4 c = texelFetch(vram, ivec2(pos.x & 1023, pos.y & 511), 0);
+	ivec4 i = ivec4(round(c * vec4(31.0, 31.0, 31.0, 1.0)));
+	return i.r | (i.g << 5) | (i.b << 10) | (i.a << 15);
+}
+
+int sampleTexture(ivec2 uv)
+{
+	// texel = (texel AND(NOT(Mask * 8))) OR((Offset AND Mask) * 8)
+	uv = (uv & ~(fragTextureWindow.xy * 8)) | ((fragTextureWindow.zw & fragTextureWindow.xy) * 8);
+	uv &= 0xff;
+
+	if (fragBitcount == 4) {
+		int index = readVram(fragTexpage + ivec2(uv.x / 4, uv.y));
+		int entry = (index >> ((uv.x & 3) * 4)) & 0xf;
+		return readVram(fragClut + ivec2(entry, 0));
+	} else if (fragBitcount == 8) {
+		int index = readVram(fragTexpage + ivec2(uv.x / 2, uv.y));
+		int entry = (index >> ((uv.x & 1) * 8)) & 0xff;
+		return readVram(fragClut + ivec2(entry, 0));
+	} else {
+		return readVram(fragTexpage + uv);
+	}
+}
+
+void main()
+{
+	bool textured = fragBitcount != 0;
+	// Interpolated color is truncated to integer, like in software renderer
+	vec3 shade = floor(fragColor);
+	vec3 color;
+	int mask = 0;
+
+	if (textured) {
+		// Rounded to nearest texel
+		int texel = sampleTexture(ivec2(floor(fragTexcoord + vec2(0.5))));
+		if (texel == 0) discard;
+
+		mask = (texel >> 15) & 1;
+		if (pass == 1 && mask == 1) discard;
+		if (pass == 2 && mask == 0) discard;
+
+		// 5-bit components scaled to 8-bit
+		color = vec3(texel & 0x1f, (texel >> 5) & 0x1f, (texel >> 10) & 0x1f) * 8.0;
+
+		if ((fragFlags & RawTexture) == 0) {
+			color = floor(color * shade / 128.0);
+		}
+	} else {
+		if (pass == 1) discard;
+		color = shade;
+	}
+
+	// Textured primitives are not dithered in software renderer
+	if (!textured && (fragFlags & Dithering) != 0) {
+		ivec2 p = ivec2(gl_FragCoord.xy) & 3;
+		color += float(ditherTable[p.y * 4 + p.x]);
+	}
+
+	color = clamp(floor(color / 8.0), 0.0, 31.0);
+	outColor = vec4(color / 31.0, float(mask));
+}
@@ -0,0 +1,34 @@
+#version 150
+
+in ivec2 position;
+in ivec3 color;
+in ivec2 texcoord;
+in int bitcount;
+in ivec2 clut;
+in ivec2 texpage;
+in int flags;
+in ivec4 textureWindow;
+
+out vec3 fragColor;
+out vec2 fragTexcoord;
+flat out int fragBitcount;
+flat out ivec2 fragClut;
+flat out ivec2 fragTexpage;
+flat out int fragFlags;
+flat out ivec4 fragTextureWindow;
+
+void main()
+{
+	// VRAM coordinates to NDC, row 0 is stored as first texture row.
+	// Shifted by half a pixel, so attributes are sampled at integer coordinates like in software renderer
+	vec2 pos = vec2(position) + vec2(0.5);
+	gl_Position = vec4(pos.x / 512.0 - 1.0, pos.y / 256.0 - 1.0, 0.0, 1.0);
+
+	fragColor = vec3(color);
+	fragTexcoord = vec2(texcoord);
+	fragBitcount = bitcount;
+	fragClut = clut;
+	fragTexpage = texpage;
+	fragFlags = flags;
+	fragTextureWindow = textureWindow;
+}
@@ -77,6 +77,11 @@ newoption {
 filter "options:enable-io-log"
 	defines "ENABLE_IO_LOG"
 
+newoption {
+	trigger = "enable-hwcompare",
+	description = "Build avocado_hwcompare (compares hardware and software renderer, needs EGL)",
+}
+
 
 filter {}
 	language "c++"
@@ -311,3 +316,80 @@ project "avocado_autotest"
 	links {
 		"common"
 	}
+
+project "avocado_gpubench"
+	uuid "5b0e3c1a-8d2f-4e67-9a41-3c7f1d2e8b90"
+	kind "ConsoleApp"
+	location "build/libs/avocado_gpubench"
+	debugdir "."
+	dependson { "common" }
+
+	includedirs { 
+		"src", 
+		"externals/glm",
+		"externals/json/include"
+	}
+
+	files { 
+		"src/platform/null/**.*",
+		"tests/bench/gpu/**.h",
+		"tests/bench/gpu/**.cpp"
+	}
+
+	links {
+		"common"
+	}
+
+project "avocado_gtebench"
+	uuid "9c2d7e41-6b3a-4f58-8e1d-2a7c5b9f0d36"
+	kind "ConsoleApp"
+	location "build/libs/avocado_gtebench"
+	debugdir "."
+	dependson { "common" }
+
+	includedirs { 
+		"src", 
+		"externals/glm",
+		"externals/json/include"
+	}
+
+	files { 
+		"src/platform/null/**.*",
+		"tests/bench/gte/**.h",
+		"tests/bench/gte/**.cpp"
+	}
+
+	links {
+		"common"
+	}
+
+if _OPTIONS["enable-hwcompare"] then
+project "avocado_hwcompare"
+	uuid "3e8a1f62-4c9d-4b07-a5e3-7d2b6c0f9a14"
+	kind "ConsoleApp"
+	location "build/libs/avocado_hwcompare"
+	debugdir "."
+	dependson { "common", "glad" }
+
+	includedirs { 
+		"src", 
+		"externals/glad/include",
+		"externals/glm",
+		"externals/json/include"
+	}
+
+	files { 
+		"src/platform/null/**.*",
+		"src/renderer/opengl/hardware_renderer.*",
+		"src/renderer/opengl/shader/**.*",
+		"tests/bench/hwcompare/**.h",
+		"tests/bench/hwcompare/**.cpp"
+	}
+
+	links {
+		"common",
+		"glad",
+		"EGL",
+		"dl"
+	}
+end
@@ -27,7 +27,10 @@ const json defaultConfig = {
         {"options", {
             {"graphics", {
                 {"filtering", false},
-                {"widescreen", false}
+                {"widescreen", false},
+                {"hardwareRendering", false},
+                {"resolutionMultiplier", 1},
+                {"frameSkip", false}
             }}
         }},
         {"debug", {
@@ -41,6 +44,7 @@ const json defaultConfig = {
 // clang-format on
 
 json config = defaultConfig;
+uint32_t configRevision = 0;
 
 json fixObject(json oldconfig, json newconfig) {
     for (auto oldField = oldconfig.begin(); oldField != oldconfig.end(); ++oldField) {
@@ -81,6 +85,7 @@ void loadConfigFile(const char* configName) {
 
     // Add missing and repair invalid fields
     config = fixObject(config, newconfig);
+    configRevision++;
 }
 
 bool isEmulatorConfigured() { return !config["bios"].get<std::string>().empty(); }
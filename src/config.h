@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
@@ -6,6 +7,9 @@ using json = nlohmann::json;
 extern const char* CONFIG_NAME;
 extern const nlohmann::json defaultConfig;
 extern nlohmann::json config;
+
+// Incremented on every config change, lets hot paths cache values instead of doing lookups
+extern uint32_t configRevision;
 void saveConfigFile(const char* configName);
 void loadConfigFile(const char* configName);
 
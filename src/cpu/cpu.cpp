@@ -13,6 +13,7 @@ CPU::CPU(System* sys) : sys(sys) {
     hi = 0;
     lo = 0;
     exception = false;
+    busStall = false;
 
     for (int i = 0; i < 2; i++) {
         slots[i].reg = 0;
@@ -100,6 +101,11 @@ bool CPU::executeInstructions(int count) {
         } else {
             PC += 4;
         }
+
+        if (busStall) {
+            busStall = false;
+            return true;
+        }
     }
     return true;
 }
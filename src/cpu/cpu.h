@@ -56,6 +56,7 @@ struct CPU {
     GTE gte;
     uint32_t hi, lo;
     bool exception;
+    bool busStall;  // DMA took over the bus, execution stops after current instruction
     std::array<LoadSlot, 2> slots;
     System* sys;
 
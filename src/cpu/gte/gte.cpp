@@ -1,3 +1,4 @@
+#include <cstring>
 #include "gte.h"
 
 uint32_t GTE::read(uint8_t n) {
@@ -80,17 +81,28 @@ uint32_t GTE::read(uint8_t n) {
                 return (int32_t)(int16_t)zsf3;  // gte_bug?: sign extended
             case 62:
                 return (int32_t)(int16_t)zsf4;  // gte_bug?: sign extended
-            case 63: flag.calculate(); return flag.reg;
+            case 63:
+                if (flagPending) calculateLazyFlag();
+                flagRead = true;
+                flag.calculate();
+                return flag.reg;
             default: return 0;
         }
     }(n);
 
-    log.push_back({GTE_ENTRY::MODE::read, n, ret});
+    log.push({GTE_ENTRY::MODE::read, n, ret});
     return ret;
 }
 
 void GTE::write(uint8_t n, uint32_t d) {
-    log.push_back({GTE_ENTRY::MODE::write, n, d});
+    log.push({GTE_ENTRY::MODE::write, n, d});
+    if (flagPending) {
+        int group = 0;
+        if (n <= 6) group = Snapshot::Vectors;
+        if ((n >= 8 && n <= 11) || (n >= 20 && n <= 28)) group = Snapshot::Results;
+        if (n >= 40 && n <= 55) group = Snapshot::Lighting;
+        if (group & ~lazy.saved) save(group);
+    }
     switch (n) {
         case 0:
             v[0].y = d >> 16;
@@ -233,39 +245,30 @@ void GTE::write(uint8_t n, uint32_t d) {
         case 60: dqb = d; break;
         case 61: zsf3 = d; break;
         case 62: zsf4 = d; break;
-        case 63: flag.reg = d & 0x7FFFF000; break;
+        case 63:
+            flag.reg = d & 0x7FFFF000;
+            flagPending = false;
+            break;
         default: return;
     }
 }
 
-bool GTE::command(gte::Command& cmd) {
-    flag.reg = 0;
-    this->sf = cmd.sf;
-    this->lm = cmd.lm;
-
-    switch (cmd.cmd) {
-        case 0x01: rtps(); return true;
-        case 0x06: nclip(); return true;
-        case 0x0c: op(cmd.sf, cmd.lm); return true;
-        case 0x10: dpcs(cmd.sf, cmd.lm); return true;
-        case 0x11: intpl(cmd.sf, cmd.lm); return true;
-        case 0x12: mvmva(cmd.sf, cmd.lm, cmd.mvmvaMultiplyMatrix, cmd.mvmvaMultiplyVector, cmd.mvmvaTranslationVector); return true;
-        case 0x13: ncds(cmd.sf, cmd.lm); return true;
-        case 0x14: cdp(cmd.sf, cmd.lm); return true;
-        case 0x16: ncdt(cmd.sf, cmd.lm); return true;
-        case 0x1b: nccs(cmd.sf, cmd.lm); return true;
-        case 0x1c: cc(cmd.sf, cmd.lm); return true;
-        case 0x1e: ncs(cmd.sf, cmd.lm, 0); return true;
-        case 0x20: nct(cmd.sf, cmd.lm); return true;
-        case 0x2a: dpct(cmd.sf, cmd.lm); return true;
-        case 0x28: sqr(); return true;
-        case 0x29: dcpl(cmd.sf, cmd.lm); return true;
-        case 0x2d: avsz3(); return true;
-        case 0x2e: avsz4(); return true;
-        case 0x30: rtpt(); return true;
-        case 0x3d: gpf(cmd.lm); return true;
-        case 0x3e: gpl(cmd.sf, cmd.lm); return true;
-        case 0x3f: ncct(cmd.sf, cmd.lm); return true;
-        default: return false;
+void GTE::save(int groups) {
+    groups &= ~lazy.saved;
+    if (groups & Snapshot::Results) {
+        memcpy(lazy.ir, ir, sizeof(ir));
+        memcpy(lazy.mac, mac, sizeof(mac));
+        memcpy(lazy.rgb, rgb, sizeof(rgb));
     }
-}
\ No newline at end of file
+    if (groups & Snapshot::Vectors) {
+        memcpy(lazy.v, v, sizeof(v));
+        lazy.rgbc = rgbc;
+    }
+    if (groups & Snapshot::Lighting) {
+        lazy.l = l;
+        lazy.lr = lr;
+        lazy.bk = bk;
+        lazy.fc = fc;
+    }
+    lazy.saved |= groups;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <utils/log_buffer.h>
 #include <utils/logic.h>
 #include <cstddef>
 #include <cstdint>
@@ -84,37 +85,39 @@ struct GTE {
     int16_t zsf4 = 0;
     Flag flag;
 
-    // Temporary, used in commands
-    bool sf;
-    bool lm;
+    // Commands are instantiated for every combination of sf (shift fraction) and lm (saturate IR to 0..7fff) bits.
+    // Lighting and color commands also have variant without FLAG calculation (flags = false), see command()
+    using Opcode = void (GTE::*)();
 
     uint32_t read(uint8_t n);
     void write(uint8_t n, uint32_t d);
 
     void nclip();
-    void ncds(bool sf, bool lm, int n = 0);
-    void ncs(bool sf, bool lm, int n = 0);
-    void nct(bool sf, bool lm);
-    void nccs(bool sf, bool lm, int n = 0);
-    void cc(bool sf, bool lm);
-    void cdp(bool sf, bool lm);
-    void ncdt(bool sf, bool lm);
-    void ncct(bool sf, bool lm);
-    void dpct(bool sf, bool lm);
-    void dpcs(bool sf, bool lm, bool useRGB0 = false);
-    void dcpl(bool sf, bool lm);
-    void intpl(bool sf, bool lm);
+    // clang-format off
+    template <bool sf, bool lm, bool flags, int n = 0> void ncds();
+    template <bool sf, bool lm, bool flags, int n = 0> void ncs();
+    template <bool sf, bool lm, bool flags> void nct();
+    template <bool sf, bool lm, bool flags, int n = 0> void nccs();
+    template <bool sf, bool lm, bool flags> void cc();
+    template <bool sf, bool lm, bool flags> void cdp();
+    template <bool sf, bool lm, bool flags> void ncdt();
+    template <bool sf, bool lm, bool flags> void ncct();
+    template <bool sf, bool lm, bool flags> void dpct();
+    template <bool sf, bool lm, bool flags, bool useRGB0 = false> void dpcs();
+    template <bool sf, bool lm, bool flags> void dcpl();
+    template <bool sf, bool lm, bool flags> void intpl();
     uint32_t divide(uint16_t h, uint16_t sz3);
     uint32_t divideUNR(uint32_t a, uint32_t b);
-    void rtps(int n = 0);
-    void rtpt();
+    template <bool sf, bool lm> void rtps();
+    template <bool sf, bool lm> void rtpt();
     void avsz3();
     void avsz4();
-    void mvmva(bool sf, bool lm, int mx, int vx, int tx);
-    void gpf(bool lm);
-    void gpl(bool sf, bool lm);
-    void sqr();
-    void op(bool sf, bool lm);
+    template <bool sf, bool lm, int mx, int vx, int tx> void mvmva();
+    template <bool sf, bool lm, bool flags> void gpf();
+    template <bool sf, bool lm, bool flags> void gpl();
+    template <bool sf, bool lm> void sqr();
+    template <bool sf, bool lm> void op();
+    // clang-format on
 
     bool command(gte::Command &cmd);
 
@@ -125,19 +128,80 @@ struct GTE {
         uint32_t data;
     };
 
-    std::vector<GTE_ENTRY> log;
+    LogBuffer<GTE_ENTRY, 0x10000> log;
 
    private:
+    // Registers read by pending command, each group is copied before it is first modified after the command
+    struct Snapshot {
+        enum Group { Results = 1 << 0, Vectors = 1 << 1, Lighting = 1 << 2, All = Results | Vectors | Lighting };
+        uint32_t command;
+        int saved;  // Groups already copied
+
+        // Saved before execution of commands that read registers they overwrite
+        int16_t ir[4];
+        int32_t mac[4];
+        Reg32 rgb[3];
+
+        gte::Vector<int16_t> v[3];
+        Reg32 rgbc;
+
+        gte::Matrix l, lr;
+        gte::Vector<int32_t> bk, fc;
+    };
+
+    // FLAG of lighting and color commands is rarely read, they run without flag bookkeeping and FLAG is calculated
+    // on read by replaying the command with flags enabled. Commands which had their FLAG read last time run eagerly.
+    Snapshot lazy;
+    bool flagPending = false;  // FLAG of lazy.command is not calculated yet
+    bool flagRead = false;     // FLAG was read after last command
+    uint8_t lastCommand = 0;
+    bool eagerFlag[64] = {};
+
+    void save(int groups);
+    void calculateLazyFlag();
+
     int countLeadingZeroes(uint32_t n);
     size_t countLeadingZeroes16(uint16_t n);
-    int32_t clip(int32_t value, int32_t max, int32_t min, uint32_t flags = 0);
+    // TODO: out 16 bit
+    INLINE int32_t clip(int32_t value, int32_t max, int32_t min, uint32_t flags = 0) {
+        if (value > max) {
+            flag.reg |= flags;
+            return max;
+        }
+        if (value < min) {
+            flag.reg |= flags;
+            return min;
+        }
+        return value;
+    }
     void check43bitsOverflow(int64_t value, uint32_t overflowBits, uint32_t underflowFlags);
 
-    int64_t setMac(int mac, int64_t value);
-    void setIr(int i, int64_t value, bool lm = false);
-    void setMacAndIr(int i, int64_t value, bool lm = false);
+    template <int i, bool sf = false, bool flags = true>
+    int64_t setMac(int64_t value);
+    template <int i, bool lm = false, bool flags = true>
+    void setIr(int64_t value);
+    template <int i, bool sf, bool lm = false, bool flags = true>
+    void setMacAndIr(int64_t value);
+
+    // MAC1..3 = (TR << 12) + MX * V, IR1..3 = saturated MAC1..3. Returns MAC3 before shift
+    template <bool sf, bool lm, bool flags = true>
+    int64_t transform(const gte::Matrix &mx, const gte::Vector<int16_t> &v, const gte::Vector<int32_t> &tr);
+    // MAC1..3 = MX * V, sum is 32 bit wide (wraps). Returns MAC3 before shift
+    template <bool sf, bool lm, bool flags = true>
+    int64_t transform(const gte::Matrix &mx, const gte::Vector<int16_t> &v);
+    // MAC1..3 = (TR << 12) + MX * IR1..3
+    template <bool sf, bool lm, bool flags = true>
+    int64_t transformIr(const gte::Matrix &mx, const gte::Vector<int32_t> &tr);
+
+    // RTPS/RTPT stages, see opcodes.cpp
+    template <bool sf, bool lm, int n>
+    void rtpTransform();
+    template <bool sf, bool lm>
+    void rtpProject(int64_t h_s3z, int16_t ir1, int16_t ir2);
+
     void setOtz(int64_t value);
     void pushScreenXY(int32_t x, int32_t y);
     void pushScreenZ(int32_t z);
+    template <bool flags>
     void pushColor(uint32_t r, uint32_t g, uint32_t b);
 };
@@ -1,78 +1,213 @@
 #include <algorithm>
-#include <cassert>
 #include <cmath>
 #include <cstdio>
+#include <cstring>
+#include <utility>
 #include "gte.h"
+#include "utils/macros.h"
 
-// TODO: out 16 bit
-int32_t GTE::clip(int32_t value, int32_t max, int32_t min, uint32_t flags) {
-    if (value > max) {
-        flag.reg |= flags;
-        return max;
-    }
-    if (value < min) {
-        flag.reg |= flags;
-        return min;
-    }
-    return value;
-}
+// Matrix multiplications are done in vector registers when SSE4.1 is available (x64 builds use AVX)
+#if defined(__SSE4_1__) || defined(__AVX__)
+#define GTE_SIMD
+#include <smmintrin.h>
+#endif
+
+namespace {
+// Flag bits for MAC/IR register, indexed by template parameter so selection is done at compile time
+// clang-format off
+constexpr uint32_t macOverflowPositive[4] = {GTE::Flag::MAC0_OVERFLOW_POSITIVE, GTE::Flag::MAC1_OVERFLOW_POSITIVE,
+                                             GTE::Flag::MAC2_OVERFLOW_POSITIVE, GTE::Flag::MAC3_OVERFLOW_POSITIVE};
+constexpr uint32_t macOverflowNegative[4] = {GTE::Flag::MAC0_OVERFLOW_NEGATIVE, GTE::Flag::MAC1_OVERFLOW_NEGATIVE,
+                                             GTE::Flag::MAC2_OVERFLOW_NEGATIVE, GTE::Flag::MAC3_OVERFLOW_NEGATIVE};
+constexpr uint32_t irSaturated[4] = {GTE::Flag::IR0_SATURATED, GTE::Flag::IR1_SATURATED,
+                                     GTE::Flag::IR2_SATURATED, GTE::Flag::IR3_SATURATED};
+// clang-format on
+}  // namespace
 
-void GTE::check43bitsOverflow(int64_t value, uint32_t overflowBits, uint32_t underflowFlags) {
+INLINE inline void GTE::check43bitsOverflow(int64_t value, uint32_t overflowBits, uint32_t underflowFlags) {
     if (value > 0x7FFFFFFFFFFLL) flag.reg |= overflowBits;
     if (value < -0x80000000000LL) flag.reg |= underflowFlags;
 }
 
-int64_t GTE::setMac(int i, int64_t value) {
-    assert(i >= 0 && i <= 3);
-    uint32_t overflowBits = 0;
-    uint32_t underflowBits = 0;
+template <int i, bool sf, bool flags>
+INLINE inline int64_t GTE::setMac(int64_t value) {
+    static_assert(i >= 0 && i <= 3, "Invalid MAC register");
 
     if (i == 0) {
-        overflowBits = Flag::MAC0_OVERFLOW_POSITIVE;
-        underflowBits = Flag::MAC0_OVERFLOW_NEGATIVE;
-
-        if (value > 0x7fffffffLL) flag.reg |= overflowBits;
-        if (value < -0x80000000LL) flag.reg |= underflowBits;
-
+        if (value > 0x7fffffffLL) flag.reg |= macOverflowPositive[0];
+        if (value < -0x80000000LL) flag.reg |= macOverflowNegative[0];
         mac[0] = (int32_t)value;
         return value;
-    } else if (i == 1) {
-        overflowBits = Flag::MAC1_OVERFLOW_POSITIVE;
-        underflowBits = Flag::MAC1_OVERFLOW_NEGATIVE;
-    } else if (i == 2) {
-        overflowBits = Flag::MAC2_OVERFLOW_POSITIVE;
-        underflowBits = Flag::MAC2_OVERFLOW_NEGATIVE;
-    } else if (i == 3) {
-        overflowBits = Flag::MAC3_OVERFLOW_POSITIVE;
-        underflowBits = Flag::MAC3_OVERFLOW_NEGATIVE;
     }
 
-    check43bitsOverflow(value, overflowBits, underflowBits);
+    if (flags) check43bitsOverflow(value, macOverflowPositive[i], macOverflowNegative[i]);
 
     if (sf) value >>= 12;
     mac[i] = (int32_t)value;
     return value;
 }
 
-// clang-format off
-void GTE::setIr(int i, int64_t value, bool lm) {
+template <int i, bool lm, bool flags>
+INLINE inline void GTE::setIr(int64_t value) {
+    static_assert(i >= 0 && i <= 3, "Invalid IR register");
+
     if (i == 0) {
         value >>= 12;
-        ir[0] = clip(value, 0x1000, 0x0000, Flag::IR0_SATURATED);
+        ir[0] = clip(value, 0x1000, 0x0000, irSaturated[0]);
         return;
     }
 
-    uint32_t saturatedBits = 0;
-    if      (i == 1) saturatedBits = Flag::IR1_SATURATED;
-    else if (i == 2) saturatedBits = Flag::IR2_SATURATED;
-    else if (i == 3) saturatedBits = Flag::IR3_SATURATED;
+    ir[i] = clip(value, 0x7fff, lm ? 0x0000 : -0x8000, flags ? irSaturated[i] : 0);
+}
 
-    if (lm) ir[i] = clip(value, 0x7fff, 0x0000, saturatedBits);
-    else    ir[i] = clip(value, 0x7fff, -0x8000, saturatedBits);
+template <int i, bool sf, bool lm, bool flags>
+INLINE inline void GTE::setMacAndIr(int64_t value) {
+    setIr<i, lm, flags>(setMac<i, sf, flags>(value));
 }
-// clang-format on
 
-void GTE::setMacAndIr(int i, int64_t value, bool lm) { setIr(i, setMac(i, value), lm); }
+#ifdef GTE_SIMD
+namespace {
+inline __m128i shuffle32(__m128i a, __m128i b, int imm) {
+    return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(a), _mm_castsi128_ps(b), imm));
+}
+
+// V as 16 bit lanes [x, y, z, 0]
+INLINE inline __m128i vector(const gte::Vector<int16_t>& v) {
+    return _mm_insert_epi16(_mm_insert_epi16(_mm_cvtsi32_si128((uint16_t)v.x), v.y, 1), v.z, 2);
+}
+
+// Rows of MX * V as pairs of 32 bit sums: [m11*x + m12*y, m13*z, m21*x + m22*y, m23*z] and [m31*x + m32*y, m33*z, 0, 0]
+INLINE inline void multiply(const gte::Matrix& mx, __m128i vec, __m128i& rows12, __m128i& row3) {
+    __m128i m = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&mx));  // v11..v32
+    __m128i m12 = _mm_shuffle_epi8(m, _mm_setr_epi8(0, 1, 2, 3, 4, 5, -1, -1, 6, 7, 8, 9, 10, 11, -1, -1));
+    __m128i m3 = _mm_shuffle_epi8(m, _mm_setr_epi8(12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    m3 = _mm_insert_epi16(m3, mx.v33, 2);
+
+    vec = _mm_unpacklo_epi64(vec, vec);
+
+    rows12 = _mm_madd_epi16(m12, vec);
+    row3 = _mm_madd_epi16(m3, vec);
+}
+
+// Lanes 0..2 of macs go to MAC1..3 and saturated to IR1..3, flag bits are taken from set lanes of overflow
+template <bool lm, bool flags>
+INLINE inline void storeMacAndIr(GTE& gte, __m128i macs, __m128i overflow) {
+    __m128i irs = _mm_min_epi32(_mm_max_epi32(macs, _mm_set1_epi32(lm ? 0 : -0x8000)), _mm_set1_epi32(0x7fff));
+    if (flags) {
+        __m128i saturated = _mm_setr_epi32(GTE::Flag::IR1_SATURATED, GTE::Flag::IR2_SATURATED, GTE::Flag::IR3_SATURATED, 0);
+        overflow = _mm_or_si128(overflow, _mm_andnot_si128(_mm_cmpeq_epi32(irs, macs), saturated));
+        overflow = _mm_or_si128(overflow, _mm_shuffle_epi32(overflow, _MM_SHUFFLE(1, 0, 3, 2)));
+        overflow = _mm_or_si128(overflow, _mm_shuffle_epi32(overflow, _MM_SHUFFLE(2, 3, 0, 1)));
+        gte.flag.reg |= _mm_cvtsi128_si32(overflow);
+    }
+
+    // MAC0 and IR0 are written back unchanged
+    macs = _mm_insert_epi32(_mm_slli_si128(macs, 4), gte.mac[0], 0);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(gte.mac), macs);
+    irs = _mm_insert_epi16(_mm_slli_si128(_mm_packs_epi32(irs, irs), 2), gte.ir[0], 0);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(gte.ir), irs);
+}
+
+template <bool sf, bool lm, bool flags>
+int64_t transformVector(GTE& gte, const gte::Matrix& mx, __m128i vec, const gte::Vector<int32_t>& tr) {
+    __m128i rows12, row3;
+    multiply(mx, vec, rows12, row3);
+
+    // Sum of two products wraps only for 8000h * 8000h + 8000h * 8000h = 2^31, which gives otherwise unreachable INT32_MIN.
+    // Pair sums are decremented before sign extension to keep it positive, 1 is added back with translation.
+    __m128i one = _mm_setr_epi32(1, 0, 1, 0);
+    rows12 = _mm_sub_epi32(rows12, one);
+    row3 = _mm_sub_epi32(row3, one);
+
+    // 64 bit sums, MAC1 and MAC2 in r12, MAC3 in lower lane of r3
+    __m128i a = _mm_cvtepi32_epi64(rows12);
+    __m128i b = _mm_cvtepi32_epi64(_mm_srli_si128(rows12, 8));
+    __m128i c = _mm_cvtepi32_epi64(row3);
+    __m128i r12 = _mm_add_epi64(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+    __m128i r3 = _mm_add_epi64(c, _mm_srli_si128(c, 8));
+
+    __m128i t12 = _mm_cvtepi32_epi64(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(&tr.x)));
+    __m128i t3 = _mm_cvtepi32_epi64(_mm_cvtsi32_si128(tr.z));
+    r12 = _mm_add_epi64(r12, _mm_add_epi64(_mm_slli_epi64(t12, 12), _mm_set1_epi64x(1)));
+    r3 = _mm_add_epi64(r3, _mm_add_epi64(_mm_slli_epi64(t3, 12), _mm_set1_epi64x(1)));
+
+    int64_t mac3;
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(&mac3), r3);
+
+    // Value doesn't fit in 44 bits if upper half is out of -800h..7ffh
+    __m128i high = shuffle32(r12, r3, _MM_SHUFFLE(3, 1, 3, 1));
+    using Flag = GTE::Flag;
+    __m128i positive = _mm_setr_epi32(Flag::MAC1_OVERFLOW_POSITIVE, Flag::MAC2_OVERFLOW_POSITIVE, Flag::MAC3_OVERFLOW_POSITIVE, 0);
+    __m128i negative = _mm_setr_epi32(Flag::MAC1_OVERFLOW_NEGATIVE, Flag::MAC2_OVERFLOW_NEGATIVE, Flag::MAC3_OVERFLOW_NEGATIVE, 0);
+    __m128i overflow = _mm_or_si128(_mm_and_si128(_mm_cmpgt_epi32(high, _mm_set1_epi32(0x7ff)), positive),
+                                    _mm_and_si128(_mm_cmplt_epi32(high, _mm_set1_epi32(-0x800)), negative));
+
+    if (sf) {
+        r12 = _mm_srli_epi64(r12, 12);
+        r3 = _mm_srli_epi64(r3, 12);
+    }
+    storeMacAndIr<lm, flags>(gte, shuffle32(r12, r3, _MM_SHUFFLE(2, 0, 2, 0)), overflow);
+    return mac3;
+}
+}  // namespace
+
+template <bool sf, bool lm, bool flags>
+int64_t GTE::transform(const gte::Matrix& mx, const gte::Vector<int16_t>& v, const gte::Vector<int32_t>& tr) {
+    return transformVector<sf, lm, flags>(*this, mx, vector(v), tr);
+}
+
+template <bool sf, bool lm, bool flags>
+int64_t GTE::transformIr(const gte::Matrix& mx, const gte::Vector<int32_t>& tr) {
+    // Single load of IR0..3 shifted to [IR1, IR2, IR3, 0]
+    return transformVector<sf, lm, flags>(*this, mx, _mm_srli_si128(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(ir)), 2), tr);
+}
+
+template <bool sf, bool lm, bool flags>
+int64_t GTE::transform(const gte::Matrix& mx, const gte::Vector<int16_t>& v) {
+    __m128i rows12, row3;
+    multiply(mx, vector(v), rows12, row3);
+
+    // 32 bit sums, same as int arithmetic in scalar version
+    __m128i sums = _mm_hadd_epi32(rows12, row3);
+    int64_t mac3 = _mm_extract_epi32(sums, 2);
+
+    storeMacAndIr<lm, flags>(*this, sf ? _mm_srai_epi32(sums, 12) : sums, _mm_setzero_si128());
+    return mac3;
+}
+#else
+template <bool sf, bool lm, bool flags>
+int64_t GTE::transform(const gte::Matrix& mx, const gte::Vector<int16_t>& v, const gte::Vector<int32_t>& tr) {
+    int64_t mac1 = (int64_t)tr.x * 0x1000 + mx.v11 * v.x + mx.v12 * v.y + mx.v13 * v.z;
+    int64_t mac2 = (int64_t)tr.y * 0x1000 + mx.v21 * v.x + mx.v22 * v.y + mx.v23 * v.z;
+    int64_t mac3 = (int64_t)tr.z * 0x1000 + mx.v31 * v.x + mx.v32 * v.y + mx.v33 * v.z;
+
+    setMacAndIr<1, sf, lm, flags>(mac1);
+    setMacAndIr<2, sf, lm, flags>(mac2);
+    setMacAndIr<3, sf, lm, flags>(mac3);
+    return mac3;
+}
+
+template <bool sf, bool lm, bool flags>
+int64_t GTE::transform(const gte::Matrix& mx, const gte::Vector<int16_t>& v) {
+    int64_t mac1 = mx.v11 * v.x + mx.v12 * v.y + mx.v13 * v.z;
+    int64_t mac2 = mx.v21 * v.x + mx.v22 * v.y + mx.v23 * v.z;
+    int64_t mac3 = mx.v31 * v.x + mx.v32 * v.y + mx.v33 * v.z;
+
+    setMacAndIr<1, sf, lm, flags>(mac1);
+    setMacAndIr<2, sf, lm, flags>(mac2);
+    setMacAndIr<3, sf, lm, flags>(mac3);
+    return mac3;
+}
+
+template <bool sf, bool lm, bool flags>
+int64_t GTE::transformIr(const gte::Matrix& mx, const gte::Vector<int32_t>& tr) {
+    gte::Vector<int16_t> vec;
+    vec.x = ir[1];
+    vec.y = ir[2];
+    vec.z = ir[3];
+    return transform<sf, lm, flags>(mx, vec, tr);
+}
+#endif
 
 void GTE::setOtz(int64_t value) {
     value >>= 12;
@@ -84,211 +219,167 @@ void GTE::setOtz(int64_t value) {
 #define B (rgbc.read(2) << 4)
 
 void GTE::nclip() {
-    setMac(0, (int64_t)s[0].x * s[1].y + s[1].x * s[2].y + s[2].x * s[0].y - s[0].x * s[2].y - s[1].x * s[0].y - s[2].x * s[1].y);
+    setMac<0>((int64_t)s[0].x * s[1].y + s[1].x * s[2].y + s[2].x * s[0].y - s[0].x * s[2].y - s[1].x * s[0].y - s[2].x * s[1].y);
 }
 
-void GTE::ncds(bool sf, bool lm, int n) {
-    setMacAndIr(1, l.v11 * v[n].x + l.v12 * v[n].y + l.v13 * v[n].z, lm);
-    setMacAndIr(2, l.v21 * v[n].x + l.v22 * v[n].y + l.v23 * v[n].z, lm);
-    setMacAndIr(3, l.v31 * v[n].x + l.v32 * v[n].y + l.v33 * v[n].z, lm);
-
-    setMac(1, ((int64_t)bk.r << 12) + lr.v11 * ir[1] + lr.v12 * ir[2] + lr.v13 * ir[3]);
-    setMac(2, ((int64_t)bk.g << 12) + lr.v21 * ir[1] + lr.v22 * ir[2] + lr.v23 * ir[3]);
-    setMac(3, ((int64_t)bk.b << 12) + lr.v31 * ir[1] + lr.v32 * ir[2] + lr.v33 * ir[3]);
-
-    // TODO: Find better way to prevent overriding ir regs
-    setIr(1, mac[1], lm);
-    setIr(2, mac[2], lm);
-    setIr(3, mac[3], lm);
+template <bool sf, bool lm, bool flags, int n>
+void GTE::ncds() {
+    transform<sf, lm, flags>(l, v[n]);
+    transformIr<sf, lm, flags>(lr, bk);
 
     int16_t prevIr[4];
     prevIr[1] = ir[1];
     prevIr[2] = ir[2];
     prevIr[3] = ir[3];
 
-    setMacAndIr(1, ((int64_t)fc.r << 12) - (R * ir[1]));
-    setMacAndIr(2, ((int64_t)fc.g << 12) - (G * ir[2]));
-    setMacAndIr(3, ((int64_t)fc.b << 12) - (B * ir[3]));
+    setMacAndIr<1, sf, false, flags>(((int64_t)fc.r << 12) - (R * ir[1]));
+    setMacAndIr<2, sf, false, flags>(((int64_t)fc.g << 12) - (G * ir[2]));
+    setMacAndIr<3, sf, false, flags>(((int64_t)fc.b << 12) - (B * ir[3]));
 
-    setMacAndIr(1, (R * prevIr[1]) + ir[0] * ir[1], lm);
-    setMacAndIr(2, (G * prevIr[2]) + ir[0] * ir[2], lm);
-    setMacAndIr(3, (B * prevIr[3]) + ir[0] * ir[3], lm);
+    setMacAndIr<1, sf, lm, flags>((R * prevIr[1]) + ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>((G * prevIr[2]) + ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>((B * prevIr[3]) + ir[0] * ir[3]);
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::ncs(bool sf, bool lm, int n) {
-    setMacAndIr(1, l.v11 * v[n].x + l.v12 * v[n].y + l.v13 * v[n].z, lm);
-    setMacAndIr(2, l.v21 * v[n].x + l.v22 * v[n].y + l.v23 * v[n].z, lm);
-    setMacAndIr(3, l.v31 * v[n].x + l.v32 * v[n].y + l.v33 * v[n].z, lm);
-
-    setMac(1, ((int64_t)bk.r << 12) + lr.v11 * ir[1] + lr.v12 * ir[2] + lr.v13 * ir[3]);
-    setMac(2, ((int64_t)bk.g << 12) + lr.v21 * ir[1] + lr.v22 * ir[2] + lr.v23 * ir[3]);
-    setMac(3, ((int64_t)bk.b << 12) + lr.v31 * ir[1] + lr.v32 * ir[2] + lr.v33 * ir[3]);
-
-    setIr(1, mac[1], lm);
-    setIr(2, mac[2], lm);
-    setIr(3, mac[3], lm);
+template <bool sf, bool lm, bool flags, int n>
+void GTE::ncs() {
+    transform<sf, lm, flags>(l, v[n]);
+    transformIr<sf, lm, flags>(lr, bk);
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::nct(bool sf, bool lm) {
-    ncs(sf, lm, 0);
-    ncs(sf, lm, 1);
-    ncs(sf, lm, 2);
+template <bool sf, bool lm, bool flags>
+void GTE::nct() {
+    ncs<sf, lm, flags, 0>();
+    ncs<sf, lm, flags, 1>();
+    ncs<sf, lm, flags, 2>();
 }
 
-void GTE::nccs(bool sf, bool lm, int n) {
-    setMacAndIr(1, l.v11 * v[n].x + l.v12 * v[n].y + l.v13 * v[n].z, lm);
-    setMacAndIr(2, l.v21 * v[n].x + l.v22 * v[n].y + l.v23 * v[n].z, lm);
-    setMacAndIr(3, l.v31 * v[n].x + l.v32 * v[n].y + l.v33 * v[n].z, lm);
-
-    setMac(1, ((int64_t)bk.r << 12) + lr.v11 * ir[1] + lr.v12 * ir[2] + lr.v13 * ir[3]);
-    setMac(2, ((int64_t)bk.g << 12) + lr.v21 * ir[1] + lr.v22 * ir[2] + lr.v23 * ir[3]);
-    setMac(3, ((int64_t)bk.b << 12) + lr.v31 * ir[1] + lr.v32 * ir[2] + lr.v33 * ir[3]);
-
-    setIr(1, mac[1], lm);
-    setIr(2, mac[2], lm);
-    setIr(3, mac[3], lm);
+template <bool sf, bool lm, bool flags, int n>
+void GTE::nccs() {
+    transform<sf, lm, flags>(l, v[n]);
+    transformIr<sf, lm, flags>(lr, bk);
 
-    setMacAndIr(1, R * ir[1], lm);
-    setMacAndIr(2, G * ir[2], lm);
-    setMacAndIr(3, B * ir[3], lm);
+    setMacAndIr<1, sf, lm, flags>(R * ir[1]);
+    setMacAndIr<2, sf, lm, flags>(G * ir[2]);
+    setMacAndIr<3, sf, lm, flags>(B * ir[3]);
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::cc(bool sf, bool lm) {
-    setMac(1, ((int64_t)bk.r << 12) + lr.v11 * ir[1] + lr.v12 * ir[2] + lr.v13 * ir[3]);
-    setMac(2, ((int64_t)bk.g << 12) + lr.v21 * ir[1] + lr.v22 * ir[2] + lr.v23 * ir[3]);
-    setMac(3, ((int64_t)bk.b << 12) + lr.v31 * ir[1] + lr.v32 * ir[2] + lr.v33 * ir[3]);
+template <bool sf, bool lm, bool flags>
+void GTE::cc() {
+    transformIr<sf, lm, flags>(lr, bk);
 
-    setIr(1, mac[1], lm);
-    setIr(2, mac[2], lm);
-    setIr(3, mac[3], lm);
+    setMacAndIr<1, sf, lm, flags>(R * ir[1]);
+    setMacAndIr<2, sf, lm, flags>(G * ir[2]);
+    setMacAndIr<3, sf, lm, flags>(B * ir[3]);
 
-    setMacAndIr(1, R * ir[1], lm);
-    setMacAndIr(2, G * ir[2], lm);
-    setMacAndIr(3, B * ir[3], lm);
-
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::cdp(bool sf, bool lm) {
-    setMac(1, ((int64_t)bk.r << 12) + lr.v11 * ir[1] + lr.v12 * ir[2] + lr.v13 * ir[3]);
-    setMac(2, ((int64_t)bk.g << 12) + lr.v21 * ir[1] + lr.v22 * ir[2] + lr.v23 * ir[3]);
-    setMac(3, ((int64_t)bk.b << 12) + lr.v31 * ir[1] + lr.v32 * ir[2] + lr.v33 * ir[3]);
-
-    setIr(1, mac[1], lm);
-    setIr(2, mac[2], lm);
-    setIr(3, mac[3], lm);
+template <bool sf, bool lm, bool flags>
+void GTE::cdp() {
+    transformIr<sf, lm, flags>(lr, bk);
 
     int16_t prevIr[4];
     prevIr[1] = ir[1];
     prevIr[2] = ir[2];
     prevIr[3] = ir[3];
 
-    setMacAndIr(1, ((int64_t)fc.r << 12) - (R * ir[1]));
-    setMacAndIr(2, ((int64_t)fc.g << 12) - (G * ir[2]));
-    setMacAndIr(3, ((int64_t)fc.b << 12) - (B * ir[3]));
+    setMacAndIr<1, sf, false, flags>(((int64_t)fc.r << 12) - (R * ir[1]));
+    setMacAndIr<2, sf, false, flags>(((int64_t)fc.g << 12) - (G * ir[2]));
+    setMacAndIr<3, sf, false, flags>(((int64_t)fc.b << 12) - (B * ir[3]));
 
-    setMacAndIr(1, (R * prevIr[1]) + ir[0] * ir[1], lm);
-    setMacAndIr(2, (G * prevIr[2]) + ir[0] * ir[2], lm);
-    setMacAndIr(3, (B * prevIr[3]) + ir[0] * ir[3], lm);
+    setMacAndIr<1, sf, lm, flags>((R * prevIr[1]) + ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>((G * prevIr[2]) + ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>((B * prevIr[3]) + ir[0] * ir[3]);
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::ncdt(bool sf, bool lm) {
-    ncds(sf, lm, 0);
-    ncds(sf, lm, 1);
-    ncds(sf, lm, 2);
+template <bool sf, bool lm, bool flags>
+void GTE::ncdt() {
+    ncds<sf, lm, flags, 0>();
+    ncds<sf, lm, flags, 1>();
+    ncds<sf, lm, flags, 2>();
 }
 
-void GTE::ncct(bool sf, bool lm) {
-    nccs(sf, lm, 0);
-    nccs(sf, lm, 1);
-    nccs(sf, lm, 2);
+template <bool sf, bool lm, bool flags>
+void GTE::ncct() {
+    nccs<sf, lm, flags, 0>();
+    nccs<sf, lm, flags, 1>();
+    nccs<sf, lm, flags, 2>();
 }
 
-void GTE::dpct(bool sf, bool lm) {
-    dpcs(sf, lm, true);
-    dpcs(sf, lm, true);
-    dpcs(sf, lm, true);
+template <bool sf, bool lm, bool flags>
+void GTE::dpct() {
+    dpcs<sf, lm, flags, true>();
+    dpcs<sf, lm, flags, true>();
+    dpcs<sf, lm, flags, true>();
 }
 
-void GTE::dpcs(bool sf, bool lm, bool useRGB0) {
+template <bool sf, bool lm, bool flags, bool useRGB0>
+void GTE::dpcs() {
     // TODO: Change to Color struct
     int16_t r = useRGB0 ? rgb[0].read(0) << 4 : R;
     int16_t g = useRGB0 ? rgb[0].read(1) << 4 : G;
     int16_t b = useRGB0 ? rgb[0].read(2) << 4 : B;
 
-    setMacAndIr(1, ((int64_t)fc.r << 12) - (r << 12));
-    setMacAndIr(2, ((int64_t)fc.g << 12) - (g << 12));
-    setMacAndIr(3, ((int64_t)fc.b << 12) - (b << 12));
+    setMacAndIr<1, sf, false, flags>(((int64_t)fc.r << 12) - (r << 12));
+    setMacAndIr<2, sf, false, flags>(((int64_t)fc.g << 12) - (g << 12));
+    setMacAndIr<3, sf, false, flags>(((int64_t)fc.b << 12) - (b << 12));
 
-    setMacAndIr(1, ((int64_t)r << 12) + ir[0] * ir[1], lm);
-    setMacAndIr(2, ((int64_t)g << 12) + ir[0] * ir[2], lm);
-    setMacAndIr(3, ((int64_t)b << 12) + ir[0] * ir[3], lm);
+    setMacAndIr<1, sf, lm, flags>(((int64_t)r << 12) + ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>(((int64_t)g << 12) + ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>(((int64_t)b << 12) + ir[0] * ir[3]);
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::dcpl(bool sf, bool lm) {
+template <bool sf, bool lm, bool flags>
+void GTE::dcpl() {
     int16_t prevIr[4];
     prevIr[1] = ir[1];
     prevIr[2] = ir[2];
     prevIr[3] = ir[3];
 
-    setMacAndIr(1, ((int64_t)fc.r << 12) - R * prevIr[1]);
-    setMacAndIr(2, ((int64_t)fc.g << 12) - G * prevIr[2]);
-    setMacAndIr(3, ((int64_t)fc.b << 12) - B * prevIr[3]);
+    setMacAndIr<1, sf, false, flags>(((int64_t)fc.r << 12) - R * prevIr[1]);
+    setMacAndIr<2, sf, false, flags>(((int64_t)fc.g << 12) - G * prevIr[2]);
+    setMacAndIr<3, sf, false, flags>(((int64_t)fc.b << 12) - B * prevIr[3]);
 
-    setMacAndIr(1, R * prevIr[1] + ir[0] * ir[1], lm);
-    setMacAndIr(2, G * prevIr[2] + ir[0] * ir[2], lm);
-    setMacAndIr(3, B * prevIr[3] + ir[0] * ir[3], lm);
+    setMacAndIr<1, sf, lm, flags>(R * prevIr[1] + ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>(G * prevIr[2] + ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>(B * prevIr[3] + ir[0] * ir[3]);
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-void GTE::intpl(bool sf, bool lm) {
+template <bool sf, bool lm, bool flags>
+void GTE::intpl() {
     int16_t prevIr[4];
     prevIr[1] = ir[1];
     prevIr[2] = ir[2];
     prevIr[3] = ir[3];
 
-    setMacAndIr(1, ((int64_t)fc.r << 12) - (prevIr[1] << 12));
-    setMacAndIr(2, ((int64_t)fc.g << 12) - (prevIr[2] << 12));
-    setMacAndIr(3, ((int64_t)fc.b << 12) - (prevIr[3] << 12));
-
-    setMacAndIr(1, (prevIr[1] << 12) + ir[0] * ir[1], lm);
-    setMacAndIr(2, (prevIr[2] << 12) + ir[0] * ir[2], lm);
-    setMacAndIr(3, (prevIr[3] << 12) + ir[0] * ir[3], lm);
+    setMacAndIr<1, sf, false, flags>(((int64_t)fc.r << 12) - (prevIr[1] << 12));
+    setMacAndIr<2, sf, false, flags>(((int64_t)fc.g << 12) - (prevIr[2] << 12));
+    setMacAndIr<3, sf, false, flags>(((int64_t)fc.b << 12) - (prevIr[3] << 12));
 
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
-}
-
-int GTE::countLeadingZeroes(uint32_t n) {
-    int zeroes = 0;
-    if ((n & 0x80000000) == 0) n = ~n;
+    setMacAndIr<1, sf, lm, flags>((prevIr[1] << 12) + ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>((prevIr[2] << 12) + ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>((prevIr[3] << 12) + ir[0] * ir[3]);
 
-    while ((n & 0x80000000) != 0) {
-        zeroes++;
-        n <<= 1;
-    }
-    return zeroes;
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
-size_t GTE::countLeadingZeroes16(uint16_t n) {
-    size_t zeroes = 0;
+// Leading bits equal to sign bit
+int GTE::countLeadingZeroes(uint32_t n) { return clz(n ^ (uint32_t)((int32_t)n >> 31)); }
 
-    while (!(n & 0x8000) && zeroes < 16) {
-        zeroes++;
-        n <<= 1;
-    }
-    return zeroes;
-}
+size_t GTE::countLeadingZeroes16(uint16_t n) { return clz(((uint32_t)n << 16) | 0x8000); }
 
 uint32_t GTE::divide(uint16_t h, uint16_t sz3) {
     if (sz3 == 0) {
@@ -303,29 +394,28 @@ uint32_t GTE::divide(uint16_t h, uint16_t sz3) {
     return n;
 }
 
-// TODO: constexpr generate this
-uint8_t unr_table[0x101]
-    = {0xff, 0xfd, 0xfb, 0xf9, 0xf7, 0xf5, 0xf3, 0xf1, 0xef, 0xee, 0xec, 0xea, 0xe8, 0xe6, 0xe4, 0xe3, 0xe1, 0xdf, 0xdd, 0xdc, 0xda, 0xd8,
-       0xd6, 0xd5, 0xd3, 0xd1, 0xd0, 0xce, 0xcd, 0xcb, 0xc9, 0xc8, 0xc6, 0xc5, 0xc3, 0xc1, 0xc0, 0xbe, 0xbd, 0xbb, 0xba, 0xb8, 0xb7, 0xb5,
-       0xb4, 0xb2, 0xb1, 0xb0, 0xae, 0xad, 0xab, 0xaa, 0xa9, 0xa7, 0xa6, 0xa4, 0xa3, 0xa2, 0xa0, 0x9f, 0x9e, 0x9c, 0x9b, 0x9a, 0x99, 0x97,
-       0x96, 0x95, 0x94, 0x92, 0x91, 0x90, 0x8f, 0x8d, 0x8c, 0x8b, 0x8a, 0x89, 0x87, 0x86, 0x85, 0x84, 0x83, 0x82, 0x81, 0x7f, 0x7e, 0x7d,
-       0x7c, 0x7b, 0x7a, 0x79, 0x78, 0x77, 0x75, 0x74, 0x73, 0x72, 0x71, 0x70, 0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x69, 0x68, 0x67, 0x66,
-       0x65, 0x64, 0x63, 0x62, 0x61, 0x60, 0x5f, 0x5e, 0x5d, 0x5d, 0x5c, 0x5b, 0x5a, 0x59, 0x58, 0x57, 0x56, 0x55, 0x54, 0x53, 0x53, 0x52,
-       0x51, 0x50, 0x4f, 0x4e, 0x4d, 0x4d, 0x4c, 0x4b, 0x4a, 0x49, 0x48, 0x48, 0x47, 0x46, 0x45, 0x44, 0x43, 0x43, 0x42, 0x41, 0x40, 0x3f,
-       0x3f, 0x3e, 0x3d, 0x3c, 0x3c, 0x3b, 0x3a, 0x39, 0x39, 0x38, 0x37, 0x36, 0x36, 0x35, 0x34, 0x33, 0x33, 0x32, 0x31, 0x31, 0x30, 0x2f,
-       0x2e, 0x2e, 0x2d, 0x2c, 0x2c, 0x2b, 0x2a, 0x2a, 0x29, 0x28, 0x28, 0x27, 0x26, 0x26, 0x25, 0x24, 0x24, 0x23, 0x22, 0x22, 0x21, 0x20,
-       0x20, 0x1f, 0x1e, 0x1e, 0x1d, 0x1d, 0x1c, 0x1b, 0x1b, 0x1a, 0x19, 0x19, 0x18, 0x18, 0x17, 0x16, 0x16, 0x15, 0x15, 0x14, 0x14, 0x13,
-       0x12, 0x12, 0x11, 0x11, 0x10, 0x0f, 0x0f, 0x0e, 0x0e, 0x0d, 0x0d, 0x0c, 0x0c, 0x0b, 0x0a, 0x0a, 0x09, 0x09, 0x08, 0x08, 0x07, 0x07,
-       0x06, 0x06, 0x05, 0x05, 0x04, 0x04, 0x03, 0x03, 0x02, 0x02, 0x01, 0x01, 0x00, 0x00, 0x00};
+namespace {
+// Initial reciprocal approximations for Newton-Raphson step, unr[i] = (0x40000 / (i + 0x100) + 1) / 2 - 0x101 (clamped to 0)
+struct UnrTable {
+    uint8_t values[0x101] = {};
+
+    constexpr UnrTable() {
+        for (int i = 0; i < 0x101; i++) values[i] = std::max(0, (0x40000 / (i + 0x100) + 1) / 2 - 0x101);
+    }
+};
+constexpr UnrTable unrTable{};
+
+static_assert(unrTable.values[0x00] == 0xff && unrTable.values[0x80] == 0x54 && unrTable.values[0x100] == 0x00, "UNR table mismatch");
 
 uint32_t recip(uint16_t divisor) {
-    int32_t x = 0x101 + unr_table[((divisor & 0x7fff) + 0x40) >> 7];
+    int32_t x = 0x101 + unrTable.values[((divisor & 0x7fff) + 0x40) >> 7];
 
     int32_t tmp = (((int32_t)divisor * -x) + 0x80) >> 8;
     int32_t tmp2 = ((x * (131072 + tmp)) + 0x80) >> 8;
 
     return tmp2;
 }
+}  // namespace
 
 uint32_t GTE::divideUNR(uint32_t lhs, uint32_t rhs) {
     if (!(rhs * 2 > lhs)) {
@@ -366,27 +456,23 @@ void GTE::pushScreenZ(int32_t z) {
     s[3].z = clip(z, 0xffff, 0x0000, Flag::SZ3_OTZ_SATURATED);
 }
 
+template <bool flags>
 void GTE::pushColor(uint32_t r, uint32_t g, uint32_t b) {
     rgb[0] = rgb[1];
     rgb[1] = rgb[2];
 
-    rgb[2].write(0, clip(r, 0xff, 0x00, Flag::COLOR_R_SATURATED));
-    rgb[2].write(1, clip(g, 0xff, 0x00, Flag::COLOR_G_SATURATED));
-    rgb[2].write(2, clip(b, 0xff, 0x00, Flag::COLOR_B_SATURATED));
+    rgb[2].write(0, clip(r, 0xff, 0x00, flags ? Flag::COLOR_R_SATURATED : 0));
+    rgb[2].write(1, clip(g, 0xff, 0x00, flags ? Flag::COLOR_G_SATURATED : 0));
+    rgb[2].write(2, clip(b, 0xff, 0x00, flags ? Flag::COLOR_B_SATURATED : 0));
     rgb[2].write(3, rgbc.read(3));
 }
 
 /**
- * Rotate, translate and perspective transformation
- *
- * Multiplicate vector (V) with rotation matrix (R),
- * translate it (TR) and apply perspective transformation.
+ * First stage of RTPS/RTPT - rotate and translate vector n, push its Z to the screen FIFO
  */
-void GTE::rtps(int n) {
-    setMacAndIr(1, (int64_t)tr.x * 0x1000 + rt.v11 * v[n].x + rt.v12 * v[n].y + rt.v13 * v[n].z, lm);
-    setMacAndIr(2, (int64_t)tr.y * 0x1000 + rt.v21 * v[n].x + rt.v22 * v[n].y + rt.v23 * v[n].z, lm);
-    int64_t mac3 = (int64_t)tr.z * 0x1000 + rt.v31 * v[n].x + rt.v32 * v[n].y + rt.v33 * v[n].z;
-    setMacAndIr(3, mac3, lm);
+template <bool sf, bool lm, int n>
+void GTE::rtpTransform() {
+    int64_t mac3 = transform<sf, lm>(rt, v[n], tr);
 
     // From Nocash docs:
     // When using RTP with sf=0, then the IR3 saturation flag (FLAG.22) gets set
@@ -397,35 +483,72 @@ void GTE::rtps(int n) {
     }
 
     pushScreenZ(mac3 >> 12);
-    int64_t h_s3z = divideUNR(h, s[3].z);
+}
 
-    int32_t x = setMac(0, h_s3z * ir[1] + of[0]) >> 16;
-    int32_t y = setMac(0, h_s3z * ir[2] + of[1]) >> 16;
+/**
+ * Second stage of RTPS/RTPT - perspective projection of transformed X, Y using H / SZ3 and depth cueing
+ */
+template <bool sf, bool lm>
+void GTE::rtpProject(int64_t h_s3z, int16_t ir1, int16_t ir2) {
+    int32_t x = setMac<0>(h_s3z * ir1 + of[0]) >> 16;
+    int32_t y = setMac<0>(h_s3z * ir2 + of[1]) >> 16;
     pushScreenXY(x, y);
 
-    setMacAndIr(0, h_s3z * dqa + dqb, lm);
+    setMacAndIr<0, sf, lm>(h_s3z * dqa + dqb);
+}
+
+/**
+ * Rotate, translate and perspective transformation
+ *
+ * Multiplicate vector (V) with rotation matrix (R),
+ * translate it (TR) and apply perspective transformation.
+ */
+template <bool sf, bool lm>
+void GTE::rtps() {
+    rtpTransform<sf, lm, 0>();
+    rtpProject<sf, lm>(divideUNR(h, s[3].z), ir[1], ir[2]);
 }
 
 /**
- * Same as RTPS, but repeated for vector 0, 1 and 2
+ * Same as RTPS, but repeated for vector 0, 1 and 2.
+ * All vectors are transformed first, so three independent divisions can be executed together.
+ * Order of register and flag updates is the same as running RTPS three times.
  */
+template <bool sf, bool lm>
 void GTE::rtpt() {
-    rtps(0);
-    rtps(1);
-    rtps(2);
+    int16_t x[3], y[3];
+    uint16_t z[3];
+    auto save = [&](int i) {
+        x[i] = ir[1];
+        y[i] = ir[2];
+        z[i] = s[3].z;
+    };
+
+    rtpTransform<sf, lm, 0>();
+    save(0);
+    rtpTransform<sf, lm, 1>();
+    save(1);
+    rtpTransform<sf, lm, 2>();
+    save(2);
+
+    uint32_t h_sz[3];
+    for (int i = 0; i < 3; i++) h_sz[i] = divideUNR(h, z[i]);
+
+    for (int i = 0; i < 3; i++) rtpProject<sf, lm>(h_sz[i], x[i], y[i]);
 }
 
 /**
  * Calculate average of 3 z values
  */
-void GTE::avsz3() { setOtz(setMac(0, (int64_t)zsf3 * (s[1].z + s[2].z + s[3].z))); }
+void GTE::avsz3() { setOtz(setMac<0>((int64_t)zsf3 * (s[1].z + s[2].z + s[3].z))); }
 
 /**
  * Calculate average of 4 z values
  */
-void GTE::avsz4() { setOtz(setMac(0, (int64_t)zsf4 * (s[0].z + s[1].z + s[2].z + s[3].z))); }
+void GTE::avsz4() { setOtz(setMac<0>((int64_t)zsf4 * (s[0].z + s[1].z + s[2].z + s[3].z))); }
 
-void GTE::mvmva(bool sf, bool lm, int mx, int vx, int tx) {
+template <bool sf, bool lm, int mx, int vx, int tx>
+void GTE::mvmva() {
     gte::Matrix Mx;
     if (mx == 0) {
         Mx = rt;
@@ -467,20 +590,18 @@ void GTE::mvmva(bool sf, bool lm, int mx, int vx, int tx) {
         Tx.x = Tx.y = Tx.z = 0;
     }
 
-    setMacAndIr(1, (int64_t)Tx.x * 0x1000 + Mx.v11 * V.x + Mx.v12 * V.y + Mx.v13 * V.z, lm);
-    setMacAndIr(2, (int64_t)Tx.y * 0x1000 + Mx.v21 * V.x + Mx.v22 * V.y + Mx.v23 * V.z, lm);
-    setMacAndIr(3, (int64_t)Tx.z * 0x1000 + Mx.v31 * V.x + Mx.v32 * V.y + Mx.v33 * V.z, lm);
+    transform<sf, lm>(Mx, V, Tx);
 
     if (tx == 2) {
         // Flag is calculated from first part (Tx << 12) + (Mx * Vx)
         // but result is only second part of expression (Mx * Vy + Mx * Vz)
-        setMacAndIr(1, (int64_t)Tx.x * 0x1000 + Mx.v11);
-        setMacAndIr(2, (int64_t)Tx.y * 0x1000 + Mx.v21);
-        setMacAndIr(3, (int64_t)Tx.z * 0x1000 + Mx.v31);
+        setMacAndIr<1, sf>((int64_t)Tx.x * 0x1000 + Mx.v11);
+        setMacAndIr<2, sf>((int64_t)Tx.y * 0x1000 + Mx.v21);
+        setMacAndIr<3, sf>((int64_t)Tx.z * 0x1000 + Mx.v31);
 
-        setMacAndIr(1, Mx.v12 * V.y + Mx.v13 * V.z, lm);
-        setMacAndIr(2, Mx.v22 * V.y + Mx.v23 * V.z, lm);
-        setMacAndIr(3, Mx.v32 * V.y + Mx.v33 * V.z, lm);
+        setMacAndIr<1, sf, lm>(Mx.v12 * V.y + Mx.v13 * V.z);
+        setMacAndIr<2, sf, lm>(Mx.v22 * V.y + Mx.v23 * V.z);
+        setMacAndIr<3, sf, lm>(Mx.v32 * V.y + Mx.v33 * V.z);
     }
 }
 
@@ -490,40 +611,151 @@ void GTE::mvmva(bool sf, bool lm, int mx, int vx, int tx) {
  *
  * Result is also saved as 24bit color
  */
-void GTE::gpf(bool lm) {
-    setMacAndIr(1, ir[0] * ir[1], lm);
-    setMacAndIr(2, ir[0] * ir[2], lm);
-    setMacAndIr(3, ir[0] * ir[3], lm);
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+template <bool sf, bool lm, bool flags>
+void GTE::gpf() {
+    setMacAndIr<1, sf, lm, flags>(ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>(ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>(ir[0] * ir[3]);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
 /**
  * Same as gpf, but add mac[i]
  * Multiply vector (ir[1..3]) by scalar(ir[0]) and add mac[1..3]
  */
-void GTE::gpl(bool sf, bool lm) {
-    setMacAndIr(1, ((int64_t)mac[1] << (sf * 12)) + ir[0] * ir[1], lm);
-    setMacAndIr(2, ((int64_t)mac[2] << (sf * 12)) + ir[0] * ir[2], lm);
-    setMacAndIr(3, ((int64_t)mac[3] << (sf * 12)) + ir[0] * ir[3], lm);
-    pushColor(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
+template <bool sf, bool lm, bool flags>
+void GTE::gpl() {
+    setMacAndIr<1, sf, lm, flags>(((int64_t)mac[1] << (sf * 12)) + ir[0] * ir[1]);
+    setMacAndIr<2, sf, lm, flags>(((int64_t)mac[2] << (sf * 12)) + ir[0] * ir[2]);
+    setMacAndIr<3, sf, lm, flags>(((int64_t)mac[3] << (sf * 12)) + ir[0] * ir[3]);
+    pushColor<flags>(mac[1] >> 4, mac[2] >> 4, mac[3] >> 4);
 }
 
 /**
  * Square vector
  * lm is ignored, as result cannot be negative
  */
+template <bool sf, bool lm>
 void GTE::sqr() {
-    setMacAndIr(1, ir[1] * ir[1]);
-    setMacAndIr(2, ir[2] * ir[2]);
-    setMacAndIr(3, ir[3] * ir[3]);
+    setMacAndIr<1, sf>(ir[1] * ir[1]);
+    setMacAndIr<2, sf>(ir[2] * ir[2]);
+    setMacAndIr<3, sf>(ir[3] * ir[3]);
 }
 
-void GTE::op(bool sf, bool lm) {
-    setMac(1, rt.v22 * ir[3] - rt.v33 * ir[2]);
-    setMac(2, rt.v33 * ir[1] - rt.v11 * ir[3]);
-    setMac(3, rt.v11 * ir[2] - rt.v22 * ir[1]);
+template <bool sf, bool lm>
+void GTE::op() {
+    setMac<1, sf>(rt.v22 * ir[3] - rt.v33 * ir[2]);
+    setMac<2, sf>(rt.v33 * ir[1] - rt.v11 * ir[3]);
+    setMac<3, sf>(rt.v11 * ir[2] - rt.v22 * ir[1]);
 
-    setIr(1, mac[1], lm);
-    setIr(2, mac[2], lm);
-    setIr(3, mac[3], lm);
-}
\ No newline at end of file
+    setIr<1, lm>(mac[1]);
+    setIr<2, lm>(mac[2]);
+    setIr<3, lm>(mac[3]);
+}
+namespace {
+/**
+ * Opcode handlers indexed by [command][sf * 2 + lm], built at compile time.
+ * MVMVA has separate table indexed by mx/vx/tx bits (13..18) of command.
+ */
+struct OpcodeTable {
+    GTE::Opcode opcodes[64][4] = {};
+    GTE::Opcode mvmva[64][4] = {};
+    GTE::Opcode lazyOpcodes[64][4] = {};  // Handlers without FLAG calculation
+    bool readsResults[64] = {};           // Command depends on IR1..3, MAC1..3 or RGB FIFO which it overwrites
+
+    constexpr OpcodeTable() {
+        fill<false, false>(0);
+        fill<false, true>(1);
+        fill<true, false>(2);
+        fill<true, true>(3);
+
+        for (int cmd : {0x11, 0x14, 0x1c, 0x29, 0x2a, 0x3d, 0x3e}) readsResults[cmd] = true;
+    }
+
+   private:
+    template <bool sf, bool lm>
+    constexpr void fill(int variant) {
+        opcodes[0x01][variant] = &GTE::rtps<sf, lm>;
+        opcodes[0x06][variant] = &GTE::nclip;
+        opcodes[0x0c][variant] = &GTE::op<sf, lm>;
+        opcodes[0x28][variant] = &GTE::sqr<sf, lm>;
+        opcodes[0x2d][variant] = &GTE::avsz3;
+        opcodes[0x2e][variant] = &GTE::avsz4;
+        opcodes[0x30][variant] = &GTE::rtpt<sf, lm>;
+
+        fillLighting<sf, lm, true>(opcodes, variant);
+        fillLighting<sf, lm, false>(lazyOpcodes, variant);
+        fillMvmva<sf, lm>(variant, std::make_index_sequence<64>{});
+    }
+
+    template <bool sf, bool lm, bool flags>
+    constexpr void fillLighting(GTE::Opcode (&table)[64][4], int variant) {
+        table[0x10][variant] = &GTE::dpcs<sf, lm, flags>;
+        table[0x11][variant] = &GTE::intpl<sf, lm, flags>;
+        table[0x13][variant] = &GTE::ncds<sf, lm, flags>;
+        table[0x14][variant] = &GTE::cdp<sf, lm, flags>;
+        table[0x16][variant] = &GTE::ncdt<sf, lm, flags>;
+        table[0x1b][variant] = &GTE::nccs<sf, lm, flags>;
+        table[0x1c][variant] = &GTE::cc<sf, lm, flags>;
+        table[0x1e][variant] = &GTE::ncs<sf, lm, flags>;
+        table[0x20][variant] = &GTE::nct<sf, lm, flags>;
+        table[0x29][variant] = &GTE::dcpl<sf, lm, flags>;
+        table[0x2a][variant] = &GTE::dpct<sf, lm, flags>;
+        table[0x3d][variant] = &GTE::gpf<sf, lm, flags>;
+        table[0x3e][variant] = &GTE::gpl<sf, lm, flags>;
+        table[0x3f][variant] = &GTE::ncct<sf, lm, flags>;
+    }
+
+    template <bool sf, bool lm, size_t... i>
+    constexpr void fillMvmva(int variant, std::index_sequence<i...>) {
+        const GTE::Opcode handlers[] = {&GTE::mvmva<sf, lm, (i >> 4) & 3, (i >> 2) & 3, i & 3>...};
+        for (size_t n = 0; n < sizeof...(i); n++) mvmva[n][variant] = handlers[n];
+    }
+};
+
+constexpr OpcodeTable opcodeTable{};
+}  // namespace
+
+bool GTE::command(gte::Command& cmd) {
+    flag.reg = 0;
+    flagPending = false;
+    eagerFlag[lastCommand] = flagRead;
+    flagRead = false;
+    lastCommand = cmd.cmd;
+
+    int variant = cmd.sf * 2 + cmd.lm;
+    Opcode handler = cmd.cmd == 0x12 ? opcodeTable.mvmva[(cmd._reg >> 13) & 0x3f][variant] : opcodeTable.opcodes[cmd.cmd][variant];
+    if (handler == nullptr) return false;
+
+    Opcode lazyHandler = opcodeTable.lazyOpcodes[cmd.cmd][variant];
+    if (lazyHandler != nullptr && !eagerFlag[cmd.cmd]) {
+        lazy.command = cmd._reg;
+        lazy.saved = 0;
+        if (opcodeTable.readsResults[cmd.cmd]) save(Snapshot::Results);
+        flagPending = true;
+        handler = lazyHandler;
+    }
+
+    (this->*handler)();
+    return true;
+}
+
+void GTE::calculateLazyFlag() {
+    flagPending = false;
+    save(Snapshot::All);
+
+    GTE replay;
+    memcpy(replay.ir, lazy.ir, sizeof(ir));
+    memcpy(replay.mac, lazy.mac, sizeof(mac));
+    memcpy(replay.rgb, lazy.rgb, sizeof(rgb));
+    memcpy(replay.v, lazy.v, sizeof(v));
+    replay.rgbc = lazy.rgbc;
+    replay.l = lazy.l;
+    replay.lr = lazy.lr;
+    replay.bk = lazy.bk;
+    replay.fc = lazy.fc;
+
+    gte::Command cmd(lazy.command);
+    (replay.*opcodeTable.opcodes[cmd.cmd][cmd.sf * 2 + cmd.lm])();
+    flag.reg = replay.flag.reg;
+}
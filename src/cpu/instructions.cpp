@@ -598,7 +598,7 @@ void op_cop0(CPU *cpu, Opcode i) {
 void op_cop2(CPU *cpu, Opcode i) {
     gte::Command command(i.opcode);
     if (i.opcode & (1 << 25)) {
-        cpu->gte.log.push_back({GTE::GTE_ENTRY::MODE::func, command.cmd, 0});
+        cpu->gte.log.push({GTE::GTE_ENTRY::MODE::func, command.cmd, 0});
 
         if (!cpu->gte.command(command)) {
             //            printf("Unhandled gte command 0x%x\n", command.cmd);
@@ -1,5 +1,4 @@
 #include "cdrom.h"
-#include <cassert>
 #include <cstdio>
 #include "config.h"
 #include "sound/audio_cd.h"
@@ -45,7 +44,7 @@ void CDROM::step() {
 
         auto posInTrack = pos - cue.tracks[track].start;
 
-        CDROM_interrupt.push_back(1);
+        postInterrupt(1);
         writeResponse(stat._reg);           // stat
         writeResponse(track);               // track
         writeResponse(0x01);                // index
@@ -57,8 +56,8 @@ void CDROM::step() {
 
         if (verbose) {
             printf("CDROM: CDDA report -> (");
-            for (auto r : CDROM_response) {
-                printf("0x%02x,", r);
+            for (size_t i = 0; i < CDROM_response.size(); i++) {
+                printf("0x%02x,", CDROM_response[i]);
             }
             printf(")\n");
         }
@@ -74,8 +73,7 @@ uint8_t CDROM::read(uint32_t address) {
     if (address == 1) {  // CD Response
         uint8_t response = 0;
         if (!CDROM_response.empty()) {
-            response = CDROM_response.front();
-            CDROM_response.pop_front();
+            response = CDROM_response.pop();
 
             if (CDROM_response.empty()) {
                 status.responseFifoEmpty = 0;
@@ -107,7 +105,7 @@ uint8_t CDROM::read(uint32_t address) {
 }
 
 void CDROM::cmdGetstat() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
@@ -120,7 +118,7 @@ void CDROM::cmdSetloc() {
     readSector = sector + (second * 75) + (minute * 60 * 75);
     dma3->seekTo(readSector);
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
@@ -142,7 +140,7 @@ void CDROM::cmdPlay() {
     if (verbose) printf("CDROM: PLAY (pos: %s)\n", pos.toString().c_str());
     stat.setMode(StatusCode::Mode::Playing);
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     AudioCD::play(cue, pos);
@@ -151,17 +149,17 @@ void CDROM::cmdPlay() {
 void CDROM::cmdReadN() {
     stat.setMode(StatusCode::Mode::Reading);
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdMotorOn() {
     stat.motor = 1;
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 }
 
@@ -170,10 +168,10 @@ void CDROM::cmdStop() {
     stat.setMode(StatusCode::Mode::None);
     stat.motor = 0;
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 
     AudioCD::stop();
@@ -181,19 +179,19 @@ void CDROM::cmdStop() {
 
 void CDROM::cmdPause() {
     if (verbose) printf("CDROM: PAUSE\n");
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     stat.setMode(StatusCode::Mode::None);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 
     AudioCD::stop();
 }
 
 void CDROM::cmdInit() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     stat.motor = 1;
@@ -202,17 +200,17 @@ void CDROM::cmdInit() {
     sectorSize = false;
     dma3->sectorSize = sectorSize;
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdMute() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdDemute() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
@@ -220,40 +218,39 @@ void CDROM::cmdSetFilter() {
     // TODO: Stub!
     int file = readParam();
     int channel = readParam();
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdSetmode() {
-    uint8_t setmode = CDROM_params.front();
-    CDROM_params.pop_front();
+    uint8_t setmode = CDROM_params.pop();
 
     sectorSize = setmode & (1 << 5) ? true : false;
     report = setmode & (1 << 2) ? true : false;
     dma3->sectorSize = sectorSize;
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     if (verbose) printf("CDROM: cmdSetmode: 0x%02x\n", setmode);
 }
 
 void CDROM::cmdSetSession() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdSeekP() {
     if (verbose) printf("CDROM: SEEKP\n");
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     stat.setMode(StatusCode::Mode::Seeking);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 
     stat.setMode(StatusCode::Mode::None);
@@ -267,7 +264,7 @@ void CDROM::cmdGetlocL() {
     uint32_t second = (tmp / 75) % 60;
     uint32_t sector = tmp % 75;
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(bcd::toBcd(minute));  // minute (track)
     writeResponse(bcd::toBcd(second));  // second (track)
     writeResponse(bcd::toBcd(sector));  // sector (track)
@@ -291,7 +288,7 @@ void CDROM::cmdGetlocP() {
 
     auto posInTrack = pos - cue.tracks[track].start;
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(track);                      // track
     writeResponse(0x01);                       // index
     writeResponse(bcd::toBcd(posInTrack.mm));  // minute (track)
@@ -303,15 +300,15 @@ void CDROM::cmdGetlocP() {
 
     if (verbose) {
         printf("CDROM: cmdGetlocP -> (");
-        for (auto r : CDROM_response) {
-            printf("0x%02x,", r);
+        for (size_t i = 0; i < CDROM_response.size(); i++) {
+            printf("0x%02x,", CDROM_response[i]);
         }
         printf(")\n");
     }
 }
 
 void CDROM::cmdGetTN() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
     writeResponse(0x01);
     writeResponse(cue.getTrackCount());
@@ -319,7 +316,7 @@ void CDROM::cmdGetTN() {
 
 void CDROM::cmdGetTD() {
     int track = readParam();
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
     if (track == 0)  // end of last track
     {
@@ -345,12 +342,12 @@ void CDROM::cmdGetTD() {
 void CDROM::cmdSeekL() {
     dma3->seekTo(readSector);
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     stat.setMode(StatusCode::Mode::Seeking);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 
     status.dataFifoEmpty = 0;
@@ -360,37 +357,37 @@ void CDROM::cmdTest() {
     uint8_t opcode = readParam();
     if (opcode == 0x20)  // Get CDROM BIOS date/version (yy,mm,dd,ver)
     {
-        CDROM_interrupt.push_back(3);
+        postInterrupt(3);
         writeResponse(0x94);
         writeResponse(0x09);
         writeResponse(0x19);
         writeResponse(0xc0);
     } else if (opcode == 0x03) {  // Force motor off, used in swap
         stat.motor = 0;
-        CDROM_interrupt.push_back(3);
+        postInterrupt(3);
         writeResponse(stat._reg);
     } else {
         printf("Unimplemented test CDROM opcode (0x%x)!\n", opcode);
-        CDROM_interrupt.push_back(5);
+        postInterrupt(5);
     }
 }
 
 void CDROM::cmdGetId() {
     // Shell open
     if (stat.getShell()) {
-        CDROM_interrupt.push_back(5);
+        postInterrupt(5);
         writeResponse(0x11);
         writeResponse(0x80);
         return;
     }
 
     // Comment to make NO$PSX bios works
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
     // No CD
     if (cue.getTrackCount() == 0) {
-        CDROM_interrupt.push_back(5);
+        postInterrupt(5);
         writeResponse(0x08);
         writeResponse(0x40);
         for (int i = 0; i < 6; i++) writeResponse(0);
@@ -399,7 +396,7 @@ void CDROM::cmdGetId() {
 
     // Audio CD
     if (cue.tracks[0].type == utils::Track::Type::AUDIO) {
-        CDROM_interrupt.push_back(5);
+        postInterrupt(5);
         writeResponse(0x0a);
         writeResponse(0x90);
         for (int i = 0; i < 6; i++) writeResponse(0);
@@ -407,7 +404,7 @@ void CDROM::cmdGetId() {
     }
 
     // Game C
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(0x02);
     writeResponse(0x00);
     writeResponse(0x20);
@@ -421,21 +418,21 @@ void CDROM::cmdGetId() {
 void CDROM::cmdReadS() {
     stat.setMode(StatusCode::Mode::Reading);
 
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdReadTOC() {
-    CDROM_interrupt.push_back(3);
+    postInterrupt(3);
     writeResponse(stat._reg);
 
-    CDROM_interrupt.push_back(2);
+    postInterrupt(2);
     writeResponse(stat._reg);
 }
 
 void CDROM::cmdUnlock() {
     // Semi implemented
-    CDROM_interrupt.push_back(5);
+    postInterrupt(5);
     writeResponse(0x11);
     writeResponse(0x40);
 }
@@ -446,9 +443,9 @@ void CDROM::handleCommand(uint8_t cmd) {
         if (!CDROM_params.empty()) {
             putchar('(');
             bool first = true;
-            for (auto p : CDROM_params) {
+            for (size_t i = 0; i < CDROM_params.size(); i++) {
                 if (!first) printf(", ");
-                printf("0x%02x", p);
+                printf("0x%02x", CDROM_params[i]);
                 first = false;
             }
             putchar(')');
@@ -508,7 +505,7 @@ void CDROM::handleCommand(uint8_t cmd) {
         cmdUnlock();
     else {
         printf("Unimplemented cmd 0x%x!\n", cmd);
-        CDROM_interrupt.push_back(5);
+        postInterrupt(5);
         writeResponse(0x11);
         writeResponse(0x40);
     }
@@ -528,10 +525,9 @@ void CDROM::write(uint32_t address, uint8_t data) {
         return handleCommand(data);
     }
     if (address == 2 && status.index == 0) {  // Parameter fifo
-        assert(CDROM_params.size() < 16);
-        CDROM_params.push_back(data);
+        CDROM_params.push(data);  // Dropped when full
         status.parameterFifoEmpty = 0;
-        status.parameterFifoFull = !(CDROM_params.size() >= 16);
+        status.parameterFifoFull = !CDROM_params.full();
         return;
     }
     if (address == 3 && status.index == 0) {  // Request register
@@ -564,9 +560,7 @@ void CDROM::write(uint32_t address, uint8_t data) {
             status.parameterFifoFull = 1;
         }
 
-        if (!CDROM_interrupt.empty()) {
-            CDROM_interrupt.pop_front();
-        }
+        CDROM_interrupt.pop();
         if (verbose == 2) printf("CDROM: W INTF: 0x%02x\n", data);
         return;
     }
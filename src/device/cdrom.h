@@ -1,7 +1,8 @@
 #pragma once
-#include <deque>
+#include <cstdio>
 #include <memory>
 #include "device.h"
+#include "utils/fifo.h"
 #include "utils/cue/cue.h"
 
 struct System;
@@ -77,9 +78,10 @@ class CDROM {
 
     CDROM_Status status;
     uint8_t interruptEnable = 0;
-    std::deque<uint8_t> CDROM_params;
-    std::deque<uint8_t> CDROM_response;
-    std::deque<uint8_t> CDROM_interrupt;
+    Fifo<uint8_t, 16> CDROM_params;
+    Fifo<uint8_t, 16> CDROM_response;
+    Fifo<uint8_t, 8> CDROM_interrupt;  // Pending INTs, the oldest is visible in interrupt flags
+    bool dropResponse = false;         // Last INT didn't fit into the queue, its response is dropped too
 
     bool sectorSize = false;  // 0 - 0x800, 1 - 0x924
     bool report = false;      // generate report on playback?
@@ -115,17 +117,20 @@ class CDROM {
     void cmdSeekP();
     void handleCommand(uint8_t cmd);
 
+    void postInterrupt(uint8_t irq) {
+        dropResponse = !CDROM_interrupt.push(irq);
+        if (dropResponse && verbose) printf("CDROM: interrupt queue full, INT%d dropped\n", irq);
+    }
+
     void writeResponse(uint8_t byte) {
-        if (CDROM_response.size() >= 16) {
+        if (dropResponse || !CDROM_response.push(byte)) {
             return;
         }
-        CDROM_response.push_back(byte);
         status.responseFifoEmpty = 1;
     }
 
     uint8_t readParam() {
-        uint8_t param = CDROM_params.front();
-        CDROM_params.pop_front();
+        uint8_t param = CDROM_params.pop();
 
         status.parameterFifoEmpty = CDROM_params.empty();
         status.parameterFifoFull = 1;
@@ -147,7 +152,7 @@ class CDROM {
     void ackMoreData() {
         status.dataFifoEmpty = 1;
 
-        CDROM_interrupt.push_back(1);
+        postInterrupt(1);
         writeResponse(stat._reg);
     }
 };
@@ -64,11 +64,11 @@ uint8_t DigitalController::handle(uint8_t byte) {
 bool DigitalController::getAck() { return state != 0; }
 
 void Controller::handleByte(uint8_t byte) {
-    rxPending = true;
+    uint8_t rx = 0xff;  // Nothing connected
 
     if ((control._reg & (1 << 13)) == 0) {
         // Port 1
-        rxData = state.handle(byte);
+        rx = state.handle(byte);
         ack = state.getAck();
         if (state.getAck()) {
             irqTimer = 3;
@@ -81,6 +81,9 @@ void Controller::handleByte(uint8_t byte) {
         //			irqTimer = 3;
         //		}
     }
+
+    // Byte received to full FIFO overwrites the last one
+    if (!rxFifo.push(rx)) rxFifo.back() = rx;
 }
 
 Controller::Controller(System* sys) : sys(sys) {}
@@ -101,12 +104,12 @@ uint8_t Controller::read(uint32_t address) {
         return getData();
     }
     if (address == 4) {
-        uint8_t data = (ack << 7) |        // /ACK Input Level 0 - High, 1 - Low
-                                           // 6, 5, 4 - 0
-                       (0 << 3) |          // Parity error
-                       (0 << 2) |          // TX Ready Flag 2
-                       (rxPending << 1) |  // RX FIFO Not Empty
-                       (1 << 0);           // TX Ready Flag 1
+        uint8_t data = (ack << 7) |              // /ACK Input Level 0 - High, 1 - Low
+                                                 // 6, 5, 4 - 0
+                       (0 << 3) |                // Parity error
+                       (0 << 2) |                // TX Ready Flag 2
+                       (!rxFifo.empty() << 1) |  // RX FIFO Not Empty
+                       (1 << 0);                 // TX Ready Flag 1
         ack = false;
         return data;
     }
@@ -130,6 +133,9 @@ void Controller::write(uint32_t address, uint8_t data) {
         if (address == 10 && (data & 0x10)) {
             irq = false;
         }
+        if (address == 10 && (data & 0x40)) {  // Reset
+            rxFifo.clear();
+        }
     } else if (address >= 14 && address < 16) {
         baud._byte[address - 14] = data;
     }
@@ -1,6 +1,7 @@
 #pragma once
 #include <string>
 #include "device.h"
+#include "utils/fifo.h"
 
 struct System;
 
@@ -54,17 +55,10 @@ class Controller {
 
     void handleByte(uint8_t byte);
 
-    uint8_t rxData = 0;
-    bool rxPending = false;
+    Fifo<uint8_t, 8> rxFifo;
     bool ack = false;
 
-    uint8_t getData() {
-        uint8_t ret = rxData;
-        rxData = 0xff;
-        rxPending = false;
-
-        return ret;
-    }
+    uint8_t getData() { return rxFifo.empty() ? 0xff : rxFifo.pop(); }
 
    public:
     Controller(System* sys);
@@ -1,5 +1,7 @@
 #include "dma.h"
+#include <algorithm>
 #include <cstdio>
+#include <iterator>
 #include "system.h"
 
 namespace device {
@@ -9,12 +11,37 @@ DMA::DMA(System* sys) : sys(sys) {
     dma[1] = std::make_unique<dmaChannel::DMAChannel>(1, sys);
     dma[2] = std::make_unique<dmaChannel::DMA2Channel>(2, sys, sys->gpu.get());
     dma[3] = std::make_unique<dmaChannel::DMA3Channel>(3, sys);
-    dma[4] = std::make_unique<dmaChannel::DMAChannel>(4, sys);
+    dma[4] = std::make_unique<dmaChannel::DMA4Channel>(4, sys, sys->spu.get());
     dma[5] = std::make_unique<dmaChannel::DMAChannel>(5, sys);
     dma[6] = std::make_unique<dmaChannel::DMA6Channel>(6, sys);
+    sortChannels();
 }
 
-void DMA::step() {
+void DMA::sortChannels() {
+    // Channels share the bus, lower DPCR priority value goes first, higher channel number wins a tie
+    std::sort(std::begin(order), std::end(order),
+              [this](int a, int b) { return priority(a) != priority(b) ? priority(a) < priority(b) : a > b; });
+}
+
+int DMA::step(int cycles) {
+    // Nothing to do until transfer is started or DICR is written
+    bool pending = statusWritten;
+    for (const auto& channel : dma) pending |= channel->isBusy() || channel->irqFlag;
+    if (!pending) return 0;
+    statusWritten = false;
+
+    int busCycles = 0;
+    for (int channel : order) {
+        if (!dma[channel]->isBusy()) continue;
+        busCycles += dma[channel]->step(std::max(0, cycles - busCycles));
+    }
+
+    for (int channel = 0; channel < 7; channel++) {
+        if (!dma[channel]->irqFlag) continue;
+        dma[channel]->irqFlag = false;
+        if (status.getEnableDma(channel)) status.setFlagDma(channel, 1);
+    }
+
     bool prevMasterFlag = status.masterFlag;
 
     uint8_t enables = (status._reg & 0x7F0000) >> 16;
@@ -24,6 +51,7 @@ void DMA::step() {
     if (!prevMasterFlag && status.masterFlag) {
         sys->interrupt->trigger(interrupt::DMA);
     }
+    return std::min(busCycles, cycles);
 }
 
 uint8_t DMA::read(uint32_t address) {
@@ -48,9 +76,11 @@ void DMA::write(uint32_t address, uint8_t data) {
         address += 0x80;
         if (address >= 0xF0 && address < 0xf4) {
             control._byte[address - 0xf0] = data;
+            sortChannels();
             return;
         }
         if (address >= 0xF4 && address < 0xf8) {
+            statusWritten = true;
             if (address == 0xf7) {
                 // Clear flags (by writing 1 to bit) which sets it to 0
                 // do not touch master flag
@@ -65,10 +95,6 @@ void DMA::write(uint32_t address, uint8_t data) {
     }
 
     dma[channel]->write(address % 0x10, data);
-    if (dma[channel]->irqFlag) {
-        dma[channel]->irqFlag = false;
-        if (status.getEnableDma(channel)) status.setFlagDma(channel, 1);
-    }
 }
 }  // namespace dma
 }  // namespace device
@@ -3,6 +3,7 @@
 #include "device.h"
 #include "dma2Channel.h"
 #include "dma3Channel.h"
+#include "dma4Channel.h"
 #include "dma6Channel.h"
 #include "dmaChannel.h"
 #include "gpu/gpu.h"
@@ -91,11 +92,20 @@ class DMA {
    private:
     System* sys;
 
+    // Channels sorted by DPCR priority, updated when DPCR is written
+    int order[7] = {0, 1, 2, 3, 4, 5, 6};
+    bool statusWritten = false;  // DICR changed, master flag has to be recalculated
+
+    int priority(int channel) const { return (control._reg >> (channel * 4)) & 7; }
+    void sortChannels();
+
    public:
     std::unique_ptr<dmaChannel::DMAChannel> dma[7];
 
     DMA(System* sys);
-    void step();
+
+    // Runs transfers in progress for given number of cycles, returns cycles CPU was stopped for
+    int step(int cycles);
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
 };
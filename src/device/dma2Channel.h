@@ -9,6 +9,7 @@ class DMA2Channel : public DMAChannel {
 
     uint32_t readDevice() override { return gpu->read(0); }
     void writeDevice(uint32_t data) override { gpu->write(0, data); }
+    void writeDeviceBlock(const uint32_t *data, size_t count) override { gpu->writeGP0Block(data, count); }
 
    public:
     DMA2Channel(int channel, System *sys, GPU *gpu) : DMAChannel(channel, sys), gpu(gpu) {}
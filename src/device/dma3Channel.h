@@ -1,4 +1,6 @@
 #pragma once
+#include <algorithm>
+#include <cstring>
 #include "dmaChannel.h"
 #include "utils/file.h"
 
@@ -9,15 +11,20 @@ class DMA3Channel : public DMAChannel {
     static const int SECTOR_SIZE = 2352;
 
     uint32_t readDevice() override {
-        uint32_t data = 0;
-        if (f == nullptr) return data;
-        for (int i = bytesReaded; i < bytesReaded + 4; i++) {
-            data |= buffer[i] << (i * 8);
-        }
-        bytesReaded += 4;
+        uint32_t data;
+        readDeviceBlock(&data, 1);
         return data;
     }
 
+    // Sector data is copied as is, reads past its end return zeroes
+    void readDeviceBlock(uint32_t* data, size_t count) override {
+        size_t bytes = count * 4;
+        size_t available = (f != nullptr && bytesReaded < SECTOR_SIZE) ? std::min<size_t>(bytes, SECTOR_SIZE - bytesReaded) : 0;
+        if (available > 0) memcpy(data, &buffer[bytesReaded], available);
+        memset(reinterpret_cast<uint8_t*>(data) + available, 0, bytes - available);
+        if (f != nullptr) bytesReaded += static_cast<int>(bytes);
+    }
+
     void writeDevice(uint32_t data) override {}
 
     void beforeRead() override {
@@ -0,0 +1,19 @@
+#pragma once
+#include "dmaChannel.h"
+#include "spu.h"
+
+namespace device {
+namespace dma {
+namespace dmaChannel {
+class DMA4Channel : public DMAChannel {
+    SPU *spu = nullptr;
+
+    void readDeviceBlock(uint32_t *data, size_t count) override { spu->readDma(data, count); }
+    void writeDeviceBlock(const uint32_t *data, size_t count) override { spu->writeDma(data, count); }
+
+   public:
+    DMA4Channel(int channel, System *sys, SPU *spu) : DMAChannel(channel, sys), spu(spu) {}
+};
+}  // namespace dmaChannel
+}  // namespace dma
+}  // namespace device
\ No newline at end of file
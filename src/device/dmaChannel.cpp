@@ -1,13 +1,81 @@
 #include "dmaChannel.h"
+#include <algorithm>
 #include <cstdio>
 #include "system.h"
+#include "utils/macros.h"
+#ifdef HAS_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace device {
 namespace dma {
 namespace dmaChannel {
+namespace {
+const uint32_t RAM_MASK = System::RAM_SIZE - 1;
+
+// Approximate bus cycles needed to move single word (MDEC in/out, GPU, CDROM, SPU, PIO, OTC)
+const int CYCLES_PER_WORD[7] = {1, 1, 1, 24, 4, 20, 1};
+
+// Splits guest RAM range into contiguous host spans, f(span, count, offset) - offset is index of first word of span in transfer
+template <typename F>
+void forEachRamSpan(uint8_t* ram, uint32_t address, size_t words, F f) {
+    uint32_t* base = reinterpret_cast<uint32_t*>(ram);
+    for (size_t done = 0; done < words;) {
+        uint32_t index = ((address + done * 4) & RAM_MASK) / 4;
+        size_t count = std::min<size_t>(words - done, System::RAM_SIZE / 4 - index);
+        f(base + index, count, done);
+        done += count;
+    }
+}
+}  // namespace
+
 DMAChannel::DMAChannel(int channel, System* sys) : channel(channel), sys(sys) {}
 
-void DMAChannel::step() {}
+int DMAChannel::step(int cycles) {
+    if (!busy) return 0;
+
+    const int cyclesPerWord = CYCLES_PER_WORD[channel];
+    bool chopping = control.choppingEnable == CHCR::ChoppingEnable::chopping;
+
+    int time = debt;
+    int busCycles = debt;
+    debt = 0;
+    while (busy && time < cycles) {
+        // CPU has the bus between windows of chopped transfer
+        if (chopWait > 0) {
+            int idle = std::min(chopWait, cycles - time);
+            chopWait -= idle;
+            time += idle;
+            continue;
+        }
+
+        if (remaining == 0) {
+            completeTransfer();
+            break;
+        }
+
+        size_t words = std::max(1, (cycles - time) / cyclesPerWord);
+        if (chopping) words = std::min<size_t>(words, chopWords);
+
+        size_t moved = transferChunk(words);
+        int used = static_cast<int>(moved) * cyclesPerWord;
+        time += used;
+        busCycles += used;
+
+        if (chopping) {
+            chopWords -= static_cast<int>(moved);
+            if (chopWords <= 0) {
+                chopWords = 1 << control.choppingDmaWindowSize;
+                chopWait = 1 << control.choppingCpuWindowSize;
+            }
+        }
+        if (remaining == 0) completeTransfer();
+    }
+
+    // Linked list node or slow device word can go over the budget, it is paid in next step
+    debt = std::max(0, time - cycles);
+    return std::min(busCycles, cycles);
+}
 
 uint8_t DMAChannel::read(uint32_t address) {
     if (address < 0x4) return baseAddress._byte[address];
@@ -26,91 +94,156 @@ void DMAChannel::write(uint32_t address, uint8_t data) {
     else if (address >= 0x8 && address < 0xc) {
         control._byte[address - 0x8] = data;
 
-        if (control.enabled != CHCR::Enabled::start) return;
+        if (control.enabled != CHCR::Enabled::start) {
+            busy = false;  // Stopped by software
+            return;
+        }
+        if (busy) return;
         control.startTrigger = CHCR::StartTrigger::clear;
 
-        if (control.syncMode == CHCR::SyncMode::startImmediately) {
-            //            printf("DMA%d mode: word @ 0x%08x\n", channel, baseAddress.address);
-
-            // TODO: Check Transfer Direction
-            // TODO: Check Memory Address Step
-
-            int addr = baseAddress.address;
-            if (channel == 3)  // CDROM
-            {
-                beforeRead();
-                if (verbose) printf("DMA%d CDROM -> CPU @ 0x%08x, count: 0x%04x\n", channel, addr, count.syncMode0.wordCount);
-                for (size_t i = 0; i < count.syncMode0.wordCount; i++) {
-                    sys->writeMemory32(addr, readDevice());
-                    addr += 4;
-                }
-                // cpu->cdrom->status.dataFifoEmpty = 0;
-            } else {
-                for (size_t i = 0; i < count.syncMode0.wordCount; i++) {
-                    if (i == count.syncMode0.wordCount - 1)
-                        sys->writeMemory32(addr, 0xffffff);
-                    else
-                        sys->writeMemory32(addr, (addr - 4) & 0xffffff);
-                    addr -= 4;
-                }
-            }
-            control.enabled = CHCR::Enabled::stop;
-        } else if (control.syncMode == CHCR::SyncMode::syncBlockToDmaRequests) {
-            uint32_t addr = baseAddress.address;
-            int blockCount = count.syncMode1.blockCount;
-            int blockSize = count.syncMode1.blockSize;
-            if (blockCount == 0) blockCount = 0x10000;
-
-            if (control.transferDirection == CHCR::TransferDirection::toMainRam)  // VRAM READ
-            {
-                //               printf("DMA%d VRAM -> CPU @ 0x%08x, BS: 0x%04x, BC: 0x%04x\n", channel, addr, blockSize, blockCount);
-
-                for (int block = 0; block < blockCount; block++) {
-                    for (int i = 0; i < blockSize; i++, addr += 4) {
-                        sys->writeMemory32(addr, readDevice());
-                    }
-                }
-            } else if (control.transferDirection == CHCR::TransferDirection::fromMainRam)  // VRAM WRITE
-            {
-                if (channel == 3 && verbose) {
-                    printf("DMA%d CPU -> VRAM @ 0x%08x, BS: 0x%04x, BC: 0x%04x\n", channel, addr, blockSize, blockCount);
-                }
-                if (channel == 4 && verbose) {
-                    printf("DMA%d CPU -> SPU @ 0x%08x, BS: 0x%04x, BC: 0x%04x\n", channel, addr, blockSize, blockCount);
-                }
-
-                for (int block = 0; block < blockCount; block++) {
-                    for (int i = 0; i < blockSize; i++, addr += 4) {
-                        writeDevice(sys->readMemory32(addr));
-                    }
-                }
+        startTransfer();
+    }
+}
+
+void DMAChannel::startTransfer() {
+    busy = true;
+    address = baseAddress.address;
+    remaining = 0;
+    debt = 0;
+    chopWords = 1 << control.choppingDmaWindowSize;
+    chopWait = 0;
+    lastTransferBytes = 0;
+
+    if (control.syncMode == CHCR::SyncMode::startImmediately) {
+        //            printf("DMA%d mode: word @ 0x%08x\n", channel, baseAddress.address);
+        remaining = count.syncMode0.wordCount;
+        if (channel == 3)  // CDROM
+        {
+            beforeRead();
+            if (verbose) printf("DMA%d CDROM -> CPU @ 0x%08x, count: 0x%04x\n", channel, address, count.syncMode0.wordCount);
+        }
+    } else if (control.syncMode == CHCR::SyncMode::syncBlockToDmaRequests) {
+        size_t blockCount = count.syncMode1.blockCount;
+        size_t blockSize = count.syncMode1.blockSize;
+        if (blockCount == 0) blockCount = 0x10000;
+        remaining = blockCount * blockSize;
+
+        if (control.transferDirection == CHCR::TransferDirection::fromMainRam) {
+            if (channel == 3 && verbose) {
+                printf("DMA%d CPU -> VRAM @ 0x%08x, BS: 0x%04zx, BC: 0x%04zx\n", channel, address, blockSize, blockCount);
             }
-        } else if (control.syncMode == CHCR::SyncMode::linkedListMode) {
-            //           printf("DMA%d linked list\n", channel);
-            int addr = baseAddress.address;
-
-            int breaker = 0;
-            for (;;) {
-                uint32_t blockInfo = sys->readMemory32(addr);
-                int commandCount = blockInfo >> 24;
-
-                addr += 4;
-                for (int i = 0; i < commandCount; i++, addr += 4) {
-                    writeDevice(sys->readMemory32(addr));
-                }
-                addr = blockInfo & 0xffffff;
-                if (addr == 0xffffff || addr == 0) break;
-
-                if (++breaker > 0x4000) {
-                    printf("GPU DMA transfer too long, breaking.\n");
-                    break;
-                }
+            if (channel == 4 && verbose) {
+                printf("DMA%d CPU -> SPU @ 0x%08x, BS: 0x%04zx, BC: 0x%04zx\n", channel, address, blockSize, blockCount);
             }
         }
+    } else if (control.syncMode == CHCR::SyncMode::linkedListMode) {
+        //           printf("DMA%d linked list\n", channel);
+        address = address & RAM_MASK & ~3;
+        remaining = 1;
+        tortoise = address;
+        power = 1;
+        length = 0;
+    }
+
+    // CPU is stopped for the whole transfer, unless it is chopped
+    if (control.choppingEnable == CHCR::ChoppingEnable::normal) sys->cpu->busStall = true;
+}
+
+size_t DMAChannel::transferChunk(size_t words) {
+    if (control.syncMode == CHCR::SyncMode::linkedListMode) return transferNode();
+
+    size_t n = std::min(words, remaining);
+    if (control.syncMode == CHCR::SyncMode::startImmediately && channel != 3) {
+        clearOrderingTable(address, n, n == remaining);
+        address -= n * 4;
+    } else {
+        if (control.syncMode == CHCR::SyncMode::syncBlockToDmaRequests
+            && control.transferDirection == CHCR::TransferDirection::fromMainRam)  // VRAM WRITE
+            transferFromRam(address, n);
+        else  // CDROM or VRAM READ
+            transferToRam(address, n);
+        address += n * 4;
+    }
+    remaining -= n;
+    return n;
+}
+
+void DMAChannel::completeTransfer() {
+    busy = false;
+    transfers++;
+    bytesTransferred += lastTransferBytes;
+
+    irqFlag = true;
+    control.enabled = CHCR::Enabled::completed;
+}
+
+void DMAChannel::transferToRam(uint32_t address, size_t words) {
+    forEachRamSpan(sys->ram, address, words, [this](uint32_t* span, size_t count, size_t) { readDeviceBlock(span, count); });
+    lastTransferBytes += words * 4;
+}
+
+void DMAChannel::transferFromRam(uint32_t address, size_t words) {
+    forEachRamSpan(sys->ram, address, words, [this](uint32_t* span, size_t count, size_t) { writeDeviceBlock(span, count); });
+    lastTransferBytes += words * 4;
+}
+
+// Ordering table - list of empty nodes linked backwards from address, the lowest one terminates it at the end of transfer
+void DMAChannel::clearOrderingTable(uint32_t address, size_t words, bool terminate) {
+    if (words == 0) return;
+
+    uint32_t first = address - (words - 1) * 4;
+    forEachRamSpan(sys->ram, first, words, [first](uint32_t* span, size_t count, size_t offset) {
+        uint32_t prev = first + (offset - 1) * 4;  // Entry points to the word before it
+        size_t i = 0;
+#ifdef HAS_SSE2
+        const __m128i mask = _mm_set1_epi32(0xffffff);
+        const __m128i step = _mm_set1_epi32(16);
+        __m128i value = _mm_add_epi32(_mm_set1_epi32(prev), _mm_setr_epi32(0, 4, 8, 12));
+        for (; i + 4 <= count; i += 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(span + i), _mm_and_si128(value, mask));
+            value = _mm_add_epi32(value, step);
+        }
+#endif
+        for (; i < count; i++) span[i] = (prev + i * 4) & 0xffffff;
+    });
+    if (terminate) reinterpret_cast<uint32_t*>(sys->ram)[(first & RAM_MASK) / 4] = 0xffffff;
+    lastTransferBytes += words * 4;
+}
 
-        irqFlag = true;
-        control.enabled = CHCR::Enabled::completed;
+// Sends single node of linked list, returns number of words read
+size_t DMAChannel::transferNode() {
+    const uint32_t* ram = reinterpret_cast<const uint32_t*>(sys->ram);
+    uint32_t blockInfo = ram[address / 4];
+    uint32_t commandCount = blockInfo >> 24;
+
+    // Packets are read directly from RAM unless node wraps around its end
+    uint32_t data = (address + 4) & RAM_MASK;
+    if (data + commandCount * 4 <= System::RAM_SIZE) {
+        writeDeviceBlock(&ram[data / 4], commandCount);
+    } else {
+        for (uint32_t i = 0; i < commandCount; i++) {
+            writeDevice(ram[((data + i * 4) & RAM_MASK) / 4]);
+        }
+    }
+    lastTransferBytes += 4 + commandCount * 4;
+
+    uint32_t next = blockInfo & 0xffffff;
+    if (next == 0xffffff || next == 0) {
+        remaining = 0;
+        return 1 + commandCount;
+    }
+    address = next & RAM_MASK & ~3;
+
+    // Brent's cycle detection - tortoise is moved to current node every power of two steps
+    if (address == tortoise) {
+        printf("DMA%d linked list loop detected at 0x%06x, breaking.\n", channel, address);
+        remaining = 0;
+    } else if (++length == power) {
+        tortoise = address;
+        power *= 2;
+        length = 0;
     }
+    return 1 + commandCount;
 }
 }  // namespace dmaChannel
 }  // namespace dma
@@ -78,15 +78,53 @@ class DMAChannel {
 
     virtual uint32_t readDevice() { return 0; }
     virtual void writeDevice(uint32_t data) {}
+    virtual void readDeviceBlock(uint32_t* data, size_t count) {
+        for (size_t i = 0; i < count; i++) data[i] = readDevice();
+    }
+    virtual void writeDeviceBlock(const uint32_t* data, size_t count) {
+        for (size_t i = 0; i < count; i++) writeDevice(data[i]);
+    }
     virtual void beforeRead() {}
 
+    // Transfer in progress, moved in chunks by step()
+    bool busy = false;
+    uint32_t address = 0;
+    size_t remaining = 0;  // Words left, for linked list 1 until its end is reached
+    int debt = 0;          // Cycles used over the budget of previous step
+    int chopWords = 0;     // Words left in DMA window of chopped transfer
+    int chopWait = 0;      // Cycles left in CPU window of chopped transfer
+
+    // Linked list loop detection, see transferNode()
+    uint32_t tortoise = 0;
+    int power = 0;
+    int length = 0;
+
+    void startTransfer();
+    size_t transferChunk(size_t words);
+    void completeTransfer();
+
+    // Transfers operate directly on RAM, address wraps around its end
+    void transferToRam(uint32_t address, size_t words);
+    void transferFromRam(uint32_t address, size_t words);
+    void clearOrderingTable(uint32_t address, size_t words, bool terminate);
+    size_t transferNode();
+
    protected:
     bool verbose = false;
 
    public:
     bool irqFlag = false;
+
+    // Statistics, bytes moved between RAM and device
+    uint64_t transfers = 0;
+    uint64_t bytesTransferred = 0;
+    uint64_t lastTransferBytes = 0;
+
     DMAChannel(int channel, System* sys);
-    void step();
+
+    // Advances transfer by given number of cycles, returns cycles the bus was used for
+    int step(int cycles);
+    bool isBusy() const { return busy; }
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
 };
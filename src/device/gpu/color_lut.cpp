@@ -0,0 +1,43 @@
+#include "color_lut.h"
+
+namespace {
+// clang-format off
+constexpr int ditherTable[4][4] = {
+    {-4, +0, -3, +1},
+    {+2, -2, +3, -1},
+    {-3, +1, -4, +0},
+    {+3, -1, +2, -2}
+};
+// clang-format on
+
+constexpr int clamp(int v, int lo, int hi) { return v < lo ? lo : (v > hi ? hi : v); }
+}  // namespace
+
+constexpr ColorLut::ColorLut() {
+    for (int c = 0; c < 32; c++) {
+        for (int m = 0; m < 256; m++) {
+            modulation[c][m] = clamp((c * m) >> 7, 0, 31);
+        }
+    }
+
+    using Transparency = GP0_E1::SemiTransparency;
+    for (int b = 0; b < 32; b++) {
+        for (int f = 0; f < 32; f++) {
+            blending[static_cast<int>(Transparency::Bby2plusFby2)][b][f] = (b + f) >> 1;
+            blending[static_cast<int>(Transparency::BplusF)][b][f] = clamp(b + f, 0, 31);
+            blending[static_cast<int>(Transparency::BminusF)][b][f] = clamp(b - f, 0, 31);
+            blending[static_cast<int>(Transparency::BplusFby4)][b][f] = clamp(b + (f >> 2), 0, 31);
+        }
+    }
+
+    for (int y = 0; y < 4; y++) {
+        for (int x = 0; x < 4; x++) {
+            for (int c = 0; c < 256; c++) {
+                dither[y][x][c] = clamp(c + ditherTable[y][x], 0, 255) >> 3;
+            }
+        }
+    }
+}
+
+// Built at compile time, no static initialization order issues
+constexpr ColorLut colorLut{};
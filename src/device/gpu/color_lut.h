@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include "psx_color.h"
+#include "registers.h"
+
+/**
+ * Precomputed tables for 15-bit color math used by software rasterizers.
+ * Every channel operation is a single lookup, results are exact PSX integer arithmetic.
+ */
+struct ColorLut {
+    // min((channel5 * brightness8) >> 7, 31), brightness 0x80 leaves channel unchanged
+    uint8_t modulation[32][256] = {};
+
+    // [GP0_E1::SemiTransparency][background][foreground] for 5-bit channels
+    uint8_t blending[4][32][32] = {};
+
+    // [y & 3][x & 3][channel8] - dither offset added, saturated and truncated to 5 bits
+    uint8_t dither[4][4][256] = {};
+
+    constexpr ColorLut();
+};
+
+extern const ColorLut colorLut;
+
+inline uint16_t modulate(uint16_t texel, RGB brightness) {
+    const auto& m = colorLut.modulation;
+    return (texel & 0x8000)                               //
+           | m[texel & 0x1f][brightness.r]                //
+           | (m[(texel >> 5) & 0x1f][brightness.g] << 5)  //
+           | (m[(texel >> 10) & 0x1f][brightness.b] << 10);
+}
+
+// Mask bit is taken from foreground
+inline uint16_t blend(uint16_t bg, uint16_t fg, GP0_E1::SemiTransparency transparency) {
+    const auto& b = colorLut.blending[static_cast<int>(transparency)];
+    return (fg & 0x8000)                                   //
+           | b[bg & 0x1f][fg & 0x1f]                       //
+           | (b[(bg >> 5) & 0x1f][(fg >> 5) & 0x1f] << 5)  //
+           | (b[(bg >> 10) & 0x1f][(fg >> 10) & 0x1f] << 10);
+}
+
+inline uint16_t dither(int x, int y, RGB color) {
+    const auto& d = colorLut.dither[y & 3][x & 3];
+    return d[color.r] | (d[color.g] << 5) | (d[color.b] << 10);
+}
@@ -0,0 +1,87 @@
+#include "command_log.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "utils/file.h"
+
+bool CommandLog::saveCapture(const std::string& path, const std::vector<uint16_t>& vram, int width, int height,
+                             const std::vector<uint32_t>& state) const {
+    if (vram.size() < (size_t)(width * height)) return false;
+
+    // Replay of incomplete frame would silently diverge
+    if (overflow) {
+        printf("GPU capture: log of this frame is incomplete (over %zu words), not saved\n", MAX_WORDS);
+        return false;
+    }
+
+    uint32_t header[] = {CAPTURE_MAGIC,    CAPTURE_VERSION,        (uint32_t)width,
+                         (uint32_t)height, (uint32_t)size(),       (uint32_t)words.size(),
+                         (uint32_t)state.size()};
+    size_t stateBytes = state.size() * sizeof(uint32_t);
+    size_t vramBytes = (width * height * sizeof(uint16_t) + 3) & ~3;
+
+    std::vector<unsigned char> file(sizeof(header) + stateBytes + vramBytes + words.size() * sizeof(uint32_t));
+    unsigned char* ptr = file.data();
+
+    memcpy(ptr, header, sizeof(header));
+    ptr += sizeof(header);
+    if (!state.empty()) memcpy(ptr, state.data(), stateBytes);
+    ptr += stateBytes;
+    memcpy(ptr, vram.data(), width * height * sizeof(uint16_t));
+    ptr += vramBytes;
+    if (!words.empty()) memcpy(ptr, words.data(), words.size() * sizeof(uint32_t));
+
+    return putFileContents(path, file);
+}
+
+bool CommandLog::loadCapture(const std::string& path, std::vector<uint16_t>& vram, int width, int height, std::vector<uint32_t>& state) {
+    auto file = getFileContents(path);
+
+    uint32_t header[7] = {};
+    if (file.size() < 6 * sizeof(uint32_t)) return false;
+    memcpy(header, file.data(), std::min(file.size(), sizeof(header)));
+
+    // Version 1 had no drawing state
+    if (header[0] != CAPTURE_MAGIC || header[1] < 1 || header[1] > CAPTURE_VERSION) {
+        printf("GPU capture: invalid file %s\n", path.c_str());
+        return false;
+    }
+    if ((int)header[2] != width || (int)header[3] != height) {
+        printf("GPU capture: unsupported VRAM size %dx%d\n", header[2], header[3]);
+        return false;
+    }
+
+    size_t headerBytes = (header[1] == 1 ? 6 : 7) * sizeof(uint32_t);
+    size_t stateCount = header[1] == 1 ? 0 : header[6];
+    size_t vramBytes = (width * height * sizeof(uint16_t) + 3) & ~3;
+    size_t entryCount = header[4];
+    size_t wordCount = header[5];
+    if (file.size() < headerBytes + (stateCount + wordCount) * sizeof(uint32_t) + vramBytes) {
+        printf("GPU capture: file %s is truncated\n", path.c_str());
+        return false;
+    }
+
+    const unsigned char* ptr = file.data() + headerBytes;
+    state.resize(stateCount);
+    if (stateCount > 0) memcpy(state.data(), ptr, stateCount * sizeof(uint32_t));
+    ptr += stateCount * sizeof(uint32_t);
+
+    vram.resize(width * height);
+    memcpy(vram.data(), ptr, width * height * sizeof(uint16_t));
+    ptr += vramBytes;
+
+    clear();
+    words.resize(wordCount);
+    if (wordCount > 0) memcpy(words.data(), ptr, wordCount * sizeof(uint32_t));
+
+    // Rebuild entry index
+    for (size_t pos = 0; pos < wordCount && offsets.size() < entryCount; pos += (words[pos] & 0xffff) + 1) {
+        offsets.push_back(pos);
+    }
+    if (offsets.size() != entryCount || (!offsets.empty() && offsets.back() + (words[offsets.back()] & 0xffff) + 1 > wordCount)) {
+        printf("GPU capture: corrupted log in %s\n", path.c_str());
+        clear();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class Command : int;
+
+/**
+ * Log of GP0 commands executed during current frame.
+ * Entries are packed into single word buffer which keeps its capacity between frames,
+ * so logging doesn't allocate after the first few frames.
+ *
+ * Entry layout:
+ *   word 0     - header: command << 24 | cmd << 16 | argument count
+ *   word 1..n  - arguments (first one without command byte)
+ */
+class CommandLog {
+    static const uint32_t CAPTURE_MAGIC = 0x4c475641;  // "AVGL"
+    static const uint32_t CAPTURE_VERSION = 2;
+    static const size_t MAX_WORDS = 4 * 1024 * 1024;
+
+    std::vector<uint32_t> words;
+    std::vector<uint32_t> offsets;  // Entry index -> position of header in words
+    bool overflow = false;
+
+   public:
+    // View into log buffer, valid until log is modified
+    struct Entry {
+        uint8_t command;
+        Command cmd;
+        const uint32_t* args;
+        size_t argCount;
+
+        const uint32_t* begin() const { return args; }
+        const uint32_t* end() const { return args + argCount; }
+    };
+
+    void clear() {
+        words.clear();
+        offsets.clear();
+        overflow = false;
+    }
+
+    void push(uint8_t command, Command cmd, const uint32_t* args, size_t argCount) {
+        if (words.size() + argCount + 1 > MAX_WORDS) {
+            overflow = true;
+            return;
+        }
+        offsets.push_back(words.size());
+        words.push_back((command << 24) | ((int)cmd << 16) | (uint32_t)argCount);
+        words.insert(words.end(), args, args + argCount);
+        if (argCount > 0) words[offsets.back() + 1] &= 0xffffff;
+    }
+
+    size_t size() const { return offsets.size(); }
+    bool empty() const { return offsets.empty(); }
+    bool isOverflown() const { return overflow; }
+
+    Entry operator[](size_t i) const {
+        const uint32_t* header = &words[offsets[i]];
+        return {(uint8_t)(*header >> 24), (Command)((*header >> 16) & 0xff), header + 1, *header & 0xffff};
+    }
+
+    /**
+     * Capture file (little endian words):
+     *   magic, version, VRAM width, VRAM height, entry count, word count, state word count (version 2+)
+     *   GP0 words restoring drawing state at the beginning of logged frame (version 2+)
+     *   VRAM at the beginning of logged frame (16bit pixels, padded to word)
+     *   packed log
+     */
+    bool saveCapture(const std::string& path, const std::vector<uint16_t>& vram, int width, int height,
+                     const std::vector<uint32_t>& state) const;
+    bool loadCapture(const std::string& path, std::vector<uint16_t>& vram, int width, int height, std::vector<uint32_t>& state);
+};
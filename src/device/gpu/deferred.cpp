@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <iterator>
+#include "gpu.h"
+
+namespace {
+// Oldest batch is drawn when queue grows over these limits (eg. game never touches area it draws to)
+const size_t MAX_DEFERRED_BATCHES = 64;
+const size_t MAX_DEFERRED_WORDS = 256 * 1024;
+
+// Texture page and CLUT sampled by primitive, texpage of rectangles comes from GP0(E1h)
+VramTiles textureTiles(Command type, uint8_t command, const uint32_t arguments[], uint32_t e1) {
+    TextureInfo tex;
+    if (type == Command::Polygon) {
+        PolygonArgs arg(command);
+        if (!arg.isTextureMapped) return {};
+        tex.palette = arguments[2];
+        tex.texpage = arguments[4 + arg.gouroudShading];
+    } else if (type == Command::Rectangle) {
+        RectangleArgs arg(command);
+        if (!arg.isTextureMapped) return {};
+        tex.palette = arguments[2];
+        tex.texpage = e1 << 16;
+    } else {
+        return {};
+    }
+
+    int bits = tex.getBitcount();
+    VramTiles tiles = vramTiles(tex.getBaseX(), tex.getBaseY(), 256 * bits / 16, 256);
+    if (bits != 16) tiles |= vramTiles(tex.getClutX(), tex.getClutY(), 1 << bits, 1);
+    return tiles;
+}
+}  // namespace
+
+bool GPU::deferPrimitive(Command type, uint8_t command, const uint32_t arguments[], int count) {
+    // Primitives drawn while VRAM to CPU transfer is in progress could be visible in its data
+    bool skip = skipRendering && gpuReadMode != 1;
+    if (backend || (!skip && deferred.empty())) return false;
+
+    Rect<int> area;
+    area.left = std::max<int>(drawingArea.left, 0);
+    area.top = std::max<int>(drawingArea.top, 0);
+    area.right = std::min<int>(drawingArea.right, VRAM_WIDTH);
+    area.bottom = std::min<int>(drawingArea.bottom, VRAM_HEIGHT);
+    VramTiles drawTiles = vramTiles(area.left, area.top, area.right - area.left, area.bottom - area.top);
+    VramTiles readTiles = textureTiles(type, command, arguments, gp0_e1._reg);
+
+    // Queued batches come first
+    if (!skip) {
+        syncDeferred(readTiles, drawTiles);
+        return false;
+    }
+
+    if (!batchOpen) {
+        if (deferred.size() >= MAX_DEFERRED_BATCHES) flushDeferred(1);
+
+        DeferredBatch batch;
+        batch.state = getDrawingState();
+        batch.area = area;
+        batch.drawTiles = drawTiles;
+        deferred.push_back(std::move(batch));
+        batchOpen = true;
+    }
+
+    auto& batch = deferred.back();
+    batch.readTiles |= readTiles;
+    batch.words.push_back((command << 24) | (arguments[0] & 0xffffff));
+    batch.words.insert(batch.words.end(), arguments + 1, arguments + count);
+
+    if (batch.words.size() >= MAX_DEFERRED_WORDS) flushDeferred();
+    return true;
+}
+
+void GPU::syncDeferred(const VramTiles& read, const VramTiles& write, const Rect<int>* cover) {
+    if (deferred.empty()) return;
+
+    auto covered = [&](const DeferredBatch& b) {
+        return cover != nullptr && b.area.left >= cover->left && b.area.top >= cover->top && b.area.right <= cover->right
+               && b.area.bottom <= cover->bottom;
+    };
+
+    // Conflicting batches are drawn together with everything queued before them
+    size_t count = 0;
+    for (size_t i = 0; i < deferred.size(); i++) {
+        const auto& b = deferred[i];
+        bool overwritten = (b.drawTiles & write).any();
+        if ((b.drawTiles & read).any() || (b.readTiles & write).any() || (overwritten && !covered(b))) {
+            count = i + 1;
+            continue;
+        }
+
+        // Batch that is going to be dropped can't be a texture source of later one
+        if (overwritten) {
+            for (size_t j = i + 1; j < deferred.size(); j++) {
+                if ((deferred[j].readTiles & b.drawTiles).any()) count = std::max(count, j + 1);
+            }
+        }
+    }
+    flushDeferred(count);
+
+    // What is left in written area is completely overwritten
+    if (cover == nullptr) return;
+    auto end = std::remove_if(deferred.begin(), deferred.end(), [&](const DeferredBatch& b) { return (b.drawTiles & write).any(); });
+    if (end != deferred.end()) {
+        deferred.erase(end, deferred.end());
+        batchOpen = false;
+    }
+}
+
+void GPU::flushDeferred(size_t count) {
+    count = std::min(count, deferred.size());
+    if (count == 0) return;
+
+    std::vector<DeferredBatch> batches(std::make_move_iterator(deferred.begin()), std::make_move_iterator(deferred.begin() + count));
+    deferred.erase(deferred.begin(), deferred.begin() + count);
+    if (deferred.empty()) batchOpen = false;
+
+    // Command that is currently being parsed and drawing state stay intact
+    Command currentCmd = cmd;
+    DrawingState currentState = getDrawingState();
+
+    for (const auto& batch : batches) {
+        for (const uint32_t& word : batch.state) replayCommand(&word);
+        for (size_t i = 0; i < batch.words.size();) {
+            i += replayCommand(&batch.words[i]);
+        }
+    }
+
+    for (const uint32_t& word : currentState) replayCommand(&word);
+    cmd = currentCmd;
+}
+
+void GPU::flushDeferredDisplay() {
+    if (deferred.empty()) return;
+
+    int width = gp1_08.getHorizontalResoulution();
+    if (gp1_08.colorDepth == GP1_08::ColorDepth::bit24) width = width * 3 / 2 + 2;
+    syncDeferred(vramTiles(displayAreaStartX, displayAreaStartY, width, gp1_08.getVerticalResoulution()), {});
+}
@@ -0,0 +1,76 @@
+#include "display.h"
+#include "gpu.h"
+#include "utils/macros.h"
+#ifdef HAS_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+inline uint32_t expand5to8(uint32_t c) { return (c << 3) | (c >> 2); }
+}  // namespace
+
+void convert15to32(const uint16_t* src, uint32_t* dst, int count) {
+    int i = 0;
+#ifdef HAS_SSE2
+    // 8 pixels per iteration, channels are expanded in 16 bit lanes and interleaved into RGBA
+    const __m128i mask5 = _mm_set1_epi16(0x1f);
+    const __m128i alpha = _mm_set1_epi16((int16_t)0xff00);
+    for (; i + 8 <= count; i += 8) {
+        __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+        __m128i r = _mm_and_si128(p, mask5);
+        __m128i g = _mm_and_si128(_mm_srli_epi16(p, 5), mask5);
+        __m128i b = _mm_and_si128(_mm_srli_epi16(p, 10), mask5);
+
+        r = _mm_or_si128(_mm_slli_epi16(r, 3), _mm_srli_epi16(r, 2));
+        g = _mm_or_si128(_mm_slli_epi16(g, 3), _mm_srli_epi16(g, 2));
+        b = _mm_or_si128(_mm_slli_epi16(b, 3), _mm_srli_epi16(b, 2));
+
+        __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        __m128i ba = _mm_or_si128(b, alpha);
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi16(rg, ba));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i + 4), _mm_unpackhi_epi16(rg, ba));
+    }
+#endif
+    for (; i < count; i++) {
+        uint16_t p = src[i];
+        dst[i] = expand5to8(p & 0x1f) | (expand5to8((p >> 5) & 0x1f) << 8) | (expand5to8((p >> 10) & 0x1f) << 16) | 0xff000000;
+    }
+}
+
+void convert24to32(const uint8_t* src, uint32_t* dst, int count) {
+    for (int i = 0; i < count; i++, src += 3) {
+        dst[i] = src[0] | (src[1] << 8) | (src[2] << 16) | 0xff000000;
+    }
+}
+
+bool decodeDisplay(GPU* gpu, std::vector<uint32_t>& rgba, int& width, int& height) {
+    gpu->flushDeferredDisplay();
+
+    width = gpu->gp1_08.getHorizontalResoulution();
+    height = gpu->gp1_08.getVerticalResoulution();
+    if (gpu->displayDisable || width <= 0 || height <= 0) return false;
+
+    bool is24bit = gpu->gp1_08.colorDepth == GP1_08::ColorDepth::bit24;
+
+    // 24 bit pixels take 1.5 halfword, one more is fetched for odd widths
+    int halfwords = is24bit ? (width * 3 + 1) / 2 + 1 : width;
+    std::vector<uint16_t> row(halfwords);
+
+    rgba.resize(width * height);
+    for (int y = 0; y < height; y++) {
+        int vy = (gpu->displayAreaStartY + y) & (VRAM_HEIGHT - 1);
+        for (int x = 0; x < halfwords; x++) {
+            row[x] = gpu->readVram((gpu->displayAreaStartX + x) & (VRAM_WIDTH - 1), vy);
+        }
+
+        uint32_t* dst = &rgba[y * width];
+        if (is24bit) {
+            convert24to32(reinterpret_cast<const uint8_t*>(row.data()), dst, width);
+        } else {
+            convert15to32(row.data(), dst, width);
+        }
+    }
+    return true;
+}
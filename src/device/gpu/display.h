@@ -0,0 +1,16 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+struct GPU;
+
+/**
+ * Converts visible display area into RGBA8888 (red in lowest byte) at native resolution.
+ * Decodes both 15 and 24 bit display modes the same way as blit shader, for use without GL context
+ * (eg. headless frame dumps). Returns false if display is disabled or has empty area.
+ */
+bool decodeDisplay(GPU* gpu, std::vector<uint32_t>& rgba, int& width, int& height);
+
+// Row converters, exposed for testing
+void convert15to32(const uint16_t* src, uint32_t* dst, int count);
+void convert24to32(const uint8_t* src, uint32_t* dst, int count);
@@ -1,14 +1,168 @@
 #include "gpu.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdio>
-#include "utils/logic.h"
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "config.h"
 #include "render.h"
+#include "utils/logic.h"
 
 const char* CommandStr[] = {"None",           "FillRectangle",  "Polygon",       "Line",           "Rectangle",
                             "CopyCpuToVram1", "CopyCpuToVram2", "CopyVramToCpu", "CopyVramToVram", "Extra"};
 
+GPU::GPU() {
+    int multiplier = config["options"]["graphics"]["resolutionMultiplier"];
+    setResolutionMultiplier(multiplier);
+}
+
+void GPU::setResolutionMultiplier(int multiplier) {
+    multiplier = std::max(1, std::min(multiplier, MAX_RESOLUTION_MULTIPLIER));
+    if (multiplier == resolutionMultiplier && !vram.empty()) return;
+
+    std::vector<uint16_t> native(VRAM_WIDTH * VRAM_HEIGHT);
+    if (!vram.empty()) {
+        for (int y = 0; y < VRAM_HEIGHT; y++) {
+            for (int x = 0; x < VRAM_WIDTH; x++) {
+                native[y * VRAM_WIDTH + x] = readVram(x, y);
+            }
+        }
+    }
+
+    resolutionMultiplier = multiplier;
+    vram.assign(getVramWidth() * getVramHeight(), 0);
+    for (int y = 0; y < VRAM_HEIGHT; y++) {
+        for (int x = 0; x < VRAM_WIDTH; x++) {
+            writeVram(x, y, native[y * VRAM_WIDTH + x]);
+        }
+    }
+
+    // Backup from previous resolution is useless
+    prevVram.clear();
+    backupValid = false;
+    dirtyTiles.set();
+}
+
+void GPU::markVram(int x, int y, int w, int h) {
+    if (w <= 0 || h <= 0) return;
+
+    int tx0 = x / VRAM_TILE_SIZE;
+    int ty0 = y / VRAM_TILE_SIZE;
+    int tilesX = std::min((x + w - 1) / VRAM_TILE_SIZE - tx0 + 1, VRAM_TILES_X);
+    int tilesY = std::min((y + h - 1) / VRAM_TILE_SIZE - ty0 + 1, VRAM_TILES_Y);
+
+    for (int ty = ty0; ty < ty0 + tilesY; ty++) {
+        for (int tx = tx0; tx < tx0 + tilesX; tx++) {
+            int tile = (ty % VRAM_TILES_Y) * VRAM_TILES_X + (tx % VRAM_TILES_X);
+            dirtyTiles.set(tile);
+            if (frameTiles.test(tile)) continue;
+            frameTiles.set(tile);
+
+            if (!backupValid) continue;
+
+            // Copy on write
+            int size = VRAM_TILE_SIZE * resolutionMultiplier;
+            int width = getVramWidth();
+            int offset = (ty % VRAM_TILES_Y) * size * width + (tx % VRAM_TILES_X) * size;
+            for (int row = 0; row < size; row++) {
+                std::copy_n(&vram[offset + row * width], size, &prevVram[offset + row * width]);
+            }
+        }
+    }
+}
+
+GPU::DrawingState GPU::getDrawingState() const {
+    return {{
+        0xe1u << 24 | gp0_e1._reg,
+        0xe2u << 24 | gp0_e2._reg,
+        0xe3u << 24 | (drawingArea.top & 0x3ff) << 10 | (drawingArea.left & 0x3ff),
+        0xe4u << 24 | (drawingArea.bottom & 0x3ff) << 10 | (drawingArea.right & 0x3ff),
+        0xe5u << 24 | (drawingOffsetY & 0x7ff) << 11 | (drawingOffsetX & 0x7ff),
+        0xe6u << 24 | gp0_e6._reg,
+    }};
+}
+
+void GPU::beginFrame() {
+    // Replay needs exact VRAM at the beginning of the frame
+    if (backupVram) flushDeferred();
+
+    frameTiles.reset();
+    frameStartState = getDrawingState();
+
+    backupValid = backupVram;
+    if (backupValid) {
+        prevVram.resize(vram.size());
+    } else {
+        prevVram.clear();
+        prevVram.shrink_to_fit();
+    }
+}
+
+bool GPU::restoreFrameStart() {
+    if (!backupValid) return false;
+
+    int size = VRAM_TILE_SIZE * resolutionMultiplier;
+    int width = getVramWidth();
+    for (int tile = 0; tile < VRAM_TILE_COUNT; tile++) {
+        if (!frameTiles.test(tile)) continue;
+
+        int offset = (tile / VRAM_TILES_X) * size * width + (tile % VRAM_TILES_X) * size;
+        for (int row = 0; row < size; row++) {
+            std::copy_n(&prevVram[offset + row * width], size, &vram[offset + row * width]);
+        }
+    }
+    dirtyTiles |= frameTiles;
+
+    // Registers are set directly, command which is being received stays intact
+    for (const uint32_t& word : frameStartState) replayCommand(&word);
+    return true;
+}
+
+bool GPU::saveLogCapture(const std::string& path) const {
+    // Stored in native resolution, tiles modified during frame are taken from backup
+    std::vector<uint16_t> native(VRAM_WIDTH * VRAM_HEIGHT);
+    for (int y = 0; y < VRAM_HEIGHT; y++) {
+        for (int x = 0; x < VRAM_WIDTH; x++) {
+            int tile = (y / VRAM_TILE_SIZE) * VRAM_TILES_X + x / VRAM_TILE_SIZE;
+            const auto& source = (backupValid && frameTiles.test(tile)) ? prevVram : vram;
+            native[y * VRAM_WIDTH + x] = source[(y * getVramWidth() + x) * resolutionMultiplier];
+        }
+    }
+    DrawingState state = backupValid ? frameStartState : getDrawingState();
+    return gpuLog.saveCapture(path, native, VRAM_WIDTH, VRAM_HEIGHT, {state.begin(), state.end()});
+}
+
+bool GPU::loadLogCapture(const std::string& path) {
+    std::vector<uint16_t> native;
+    std::vector<uint32_t> state;
+    if (!gpuLog.loadCapture(path, native, VRAM_WIDTH, VRAM_HEIGHT, state)) return false;
+
+    for (int y = 0; y < VRAM_HEIGHT; y++) {
+        for (int x = 0; x < VRAM_WIDTH; x++) {
+            writeVram(x, y, native[y * VRAM_WIDTH + x]);
+        }
+    }
+    dirtyTiles.set();
+
+    // Only single word GP0(E1h..E6h) commands are expected in capture
+    for (const uint32_t& word : state) {
+        if ((word >> 24) >= 0xe1 && (word >> 24) <= 0xe6) replayCommand(&word);
+    }
+
+    // Loaded VRAM becomes beginning of the frame
+    backupVram = true;
+    beginFrame();
+    return true;
+}
+
 void GPU::reset() {
     irqRequest = false;
+    irqPending = false;
+    cmd = Command::None;
+    polyline.active = false;
+    deferred.clear();
+    batchOpen = false;
     displayDisable = true;
     dmaDirection = 0;
     displayAreaStartX = 0;
@@ -28,6 +182,8 @@ void GPU::reset() {
     drawingOffsetY = 0;
 
     gp0_e6._reg = 0;
+
+    updateTiming();
 }
 
 void GPU::drawPolygon(int16_t x[4], int16_t y[4], RGB c[4], TextureInfo t, bool isQuad, bool textured, int flags) {
@@ -45,23 +201,51 @@ void GPU::drawPolygon(int16_t x[4], int16_t y[4], RGB c[4], TextureInfo t, bool
         baseY = t.getBaseY();
         bitcount = t.getBitcount();
         flags |= ((int)t.semiTransparencyBlending()) << 5;
+    } else {
+        flags |= ((int)gp0_e1.semiTransparency) << 5;
     }
 
-    Vertex v[3];
+    int window[4] = {static_cast<int>(gp0_e2.textureWindowMaskX), static_cast<int>(gp0_e2.textureWindowMaskY),
+                     static_cast<int>(gp0_e2.textureWindowOffsetX), static_cast<int>(gp0_e2.textureWindowOffsetY)};
+
+    Vertex v[6];
     for (int i : {0, 1, 2}) {
-        v[i] = {{x[i], y[i]}, {c[i].r, c[i].g, c[i].b}, {t.uv[i].x, t.uv[i].y}, bitcount, {clutX, clutY}, {baseX, baseY}, flags};
+        v[i] = {{x[i], y[i]},
+                {c[i].r, c[i].g, c[i].b},
+                {t.uv[i].x, t.uv[i].y},
+                bitcount,
+                {clutX, clutY},
+                {baseX, baseY},
+                flags,
+                {window[0], window[1], window[2], window[3]}};
     }
-    drawTriangle(this, v);
-
     if (isQuad) {
         for (int i : {1, 2, 3}) {
-            v[i - 1] = {{x[i], y[i]}, {c[i].r, c[i].g, c[i].b}, {t.uv[i].x, t.uv[i].y}, bitcount, {clutX, clutY}, {baseX, baseY}, flags};
+            v[i + 2] = {{x[i], y[i]},
+                        {c[i].r, c[i].g, c[i].b},
+                        {t.uv[i].x, t.uv[i].y},
+                        bitcount,
+                        {clutX, clutY},
+                        {baseX, baseY},
+                        flags,
+                        {window[0], window[1], window[2], window[3]}};
         }
-        drawTriangle(this, v);
     }
+
+    if (backend) {
+        backend->drawTriangles(v, isQuad ? 6 : 3);
+        return;
+    }
+
+    int count = isQuad ? 4 : 3;
+    markDrawing(*std::min_element(x, x + count), *std::min_element(y, y + count), *std::max_element(x, x + count),
+                *std::max_element(y, y + count));
+
+    drawTriangle(this, v);
+    if (isQuad) drawTriangle(this, v + 3);
 }
 
-void GPU::cmdFillRectangle(uint8_t command, uint32_t arguments[]) {
+void GPU::cmdFillRectangle(const uint32_t arguments[]) {
     // I'm sorry, but it appears that C++ doesn't have local functions.
     struct mask {
         constexpr static int startX(int x) { return x & 0x3f0; }
@@ -77,17 +261,36 @@ void GPU::cmdFillRectangle(uint8_t command, uint32_t arguments[]) {
 
     uint32_t color = to15bit(arguments[0] & 0xffffff);
 
+    if (backend) {
+        backend->fillRectangle(startX, startY, endX - startX, endY - startY, color);
+        cmd = Command::None;
+        return;
+    }
+
+    Rect<int> area;
+    area.left = startX;
+    area.top = startY;
+    area.right = endX;
+    area.bottom = endY;
+    syncDeferred({}, vramTiles(startX, startY, endX - startX, endY - startY), &area);
+
+    markVram(startX, startY, endX - startX, endY - startY);
+
     // Note: not sure if coords should include last column and row
-    for (int y = startY; y < endY; y++) {
-        for (int x = startX; x < endX; x++) {
-            VRAM[y][x] = color;
+    int width = getVramWidth();
+    int scale = resolutionMultiplier;
+    if (startX < endX) {
+        for (int y = startY * scale; y < endY * scale; y++) {
+            std::fill_n(&vram[y * width + startX * scale], (endX - startX) * scale, (uint16_t)color);
         }
     }
 
     cmd = Command::None;
 }
 
-void GPU::cmdPolygon(PolygonArgs arg, uint32_t arguments[]) {
+template <uint8_t command>
+void GPU::cmdPolygon(const uint32_t arguments[]) {
+    const PolygonArgs arg(command);
     int ptr = 1;
     int16_t x[4], y[4];
     RGB c[4] = {};
@@ -116,43 +319,97 @@ void GPU::cmdPolygon(PolygonArgs arg, uint32_t arguments[]) {
     cmd = Command::None;
 }
 
-// fixme: handle multiline with > 15 lines (arguments array hold only 31 elements)
-void GPU::cmdLine(LineArgs arg, uint32_t arguments[]) {
-    int ptr = 1;
-    int16_t x[2] = {}, y[2] = {};
-    RGB c[2] = {};
-
-    int lineCount = (!arg.polyLine) ? 1 : 15;
-    for (int i = 0; i < lineCount; i++) {
-        if (arguments[ptr] == 0x50005000 || arguments[ptr] == 0x55555555) break;
-        if (i == 0) {
-            x[0] = (arguments[ptr] & 0xffff);
-            y[0] = (arguments[ptr++] & 0xffff0000) >> 16;
-            c[0].raw = (arguments[0] & 0xffffff);
-        } else {
-            x[0] = x[1];
-            y[0] = y[1];
-            c[0] = c[1];
+template <uint8_t command>
+void GPU::cmdLine(const uint32_t arguments[]) {
+    const LineArgs arg(command);
+    uint32_t color1 = arg.gouroudShading ? arguments[2] : arguments[0];
+    uint32_t position1 = arguments[arg.gouroudShading ? 3 : 2];
+    drawLineSegment(arg, arguments[0], arguments[1], color1, position1);
+
+    cmd = Command::None;
+}
+
+void GPU::drawLineSegment(LineArgs arg, uint32_t color0, uint32_t position0, uint32_t color1, uint32_t position1) {
+    int flags = 0;
+    if (arg.semiTransparency) flags |= Vertex::SemiTransparency | ((int)gp0_e1.semiTransparency << 5);
+    if (arg.gouroudShading) flags |= Vertex::GouroudShading;
+    if (gp0_e1.dither24to15) flags |= Vertex::Dithering;
+
+    Vertex v[2] = {};
+    uint32_t color[2] = {color0, color1};
+    uint32_t position[2] = {position0, position1};
+    for (int i : {0, 1}) {
+        RGB c;
+        c.raw = color[i];
+        v[i].position[0] = extend_sign<10>(position[i] & 0xffff) + drawingOffsetX;
+        v[i].position[1] = extend_sign<10>(position[i] >> 16) + drawingOffsetY;
+        v[i].color[0] = c.r;
+        v[i].color[1] = c.g;
+        v[i].color[2] = c.b;
+        v[i].flags = flags;
+    }
+
+    if (backend) {
+        backend->drawLine(v);
+        return;
+    }
+    drawLine(this, v);
+}
+
+void GPU::cmdPolylineStart(const uint32_t arguments[]) {
+    cmd = Command::Line;
+    polyline.active = true;
+    polyline.expectColor = false;
+    polyline.vertices = 0;
+    polyline.nextColor = arguments[0];
+}
+
+size_t GPU::writePolyline(const uint32_t* data, size_t count) {
+    LineArgs arg(command);
+    size_t used = 0;
+
+    while (used < count && polyline.active) {
+        uint32_t word = data[used++];
+
+        // Terminator is accepted in place of any word after the first segment
+        if (polyline.vertices >= 2 && (word & 0xf000f000) == 0x50005000) {
+            polyline.active = false;
+            cmd = Command::None;
+            break;
         }
 
-        if (arg.gouroudShading) {
-            c[1].raw = arguments[ptr++];
-        } else {
-            c[1].raw = (arguments[0] & 0xffffff);
+        if (polyline.expectColor) {
+            polyline.nextColor = word & 0xffffff;
+            polyline.expectColor = false;
+            continue;
         }
 
-        x[1] = (arguments[ptr] & 0xffff);
-        y[1] = (arguments[ptr++] & 0xffff0000) >> 16;
+        if (polyline.vertices > 0) {
+            // Every segment is logged (and deferred) as separate line
+            uint32_t segment[] = {polyline.color, polyline.position, polyline.nextColor, word};
+            int segmentWords = 4;
+            if (!arg.gouroudShading) {
+                segment[2] = word;
+                segmentWords = 3;
+            }
+            if (gpuLogEnabled) gpuLog.push(command & ~0x08, Command::Line, segment, segmentWords);
+            if (!deferPrimitive(Command::Line, command & ~0x08, segment, segmentWords)) {
+                drawLineSegment(arg, polyline.color, polyline.position, polyline.nextColor, word);
+            }
+        }
 
-        // No transparency support
-        // No Gouroud Shading
-        drawLine(this, x, y, c);
+        polyline.color = polyline.nextColor;
+        polyline.position = word;
+        polyline.vertices++;
+        polyline.expectColor = arg.gouroudShading;
     }
 
-    cmd = Command::None;
+    return used;
 }
 
-void GPU::cmdRectangle(RectangleArgs arg, uint32_t arguments[]) {
+template <uint8_t command>
+void GPU::cmdRectangle(const uint32_t arguments[]) {
+    const RectangleArgs arg(command);
     int16_t w = arg.getSize();
     int16_t h = arg.getSize();
 
@@ -164,6 +421,26 @@ void GPU::cmdRectangle(RectangleArgs arg, uint32_t arguments[]) {
     int16_t x = arguments[1] & 0xffff;
     int16_t y = (arguments[1] & 0xffff0000) >> 16;
 
+    if (backend == nullptr) {
+        RGB color;
+        color.raw = arguments[0];
+
+        TextureInfo tex;
+        tex.palette = arguments[2];
+        tex.texpage = (gp0_e1._reg << 16);
+        tex.uv[0].x = arguments[2] & 0xff;
+        tex.uv[0].y = (arguments[2] & 0xff00) >> 8;
+
+        int flags = 0;
+        if (arg.semiTransparency) flags |= Vertex::SemiTransparency;
+        if (arg.isRawTexture) flags |= Vertex::RawTexture;
+
+        drawRectangle(this, x, y, w, h, color, tex, arg.isTextureMapped, flags);
+
+        cmd = Command::None;
+        return;
+    }
+
     int16_t _x[4];
     int16_t _y[4];
     RGB _c[4];
@@ -221,7 +498,7 @@ struct MaskCopy {
     constexpr static int endY(int y) { return ((y - 1) & 0x1ff) + 1; }
 };
 
-void GPU::cmdCpuToVram1(uint8_t command, uint32_t arguments[]) {
+void GPU::cmdCpuToVram1(const uint32_t arguments[]) {
     if ((arguments[0] & 0x00ffffff) != 0) {
         printf("cmdCpuToVram1: Suspicious arg0: 0x%x\n", arguments[0]);
     }
@@ -231,31 +508,65 @@ void GPU::cmdCpuToVram1(uint8_t command, uint32_t arguments[]) {
     endX = startX + MaskCopy::endX(arguments[2] & 0xffff);
     endY = startY + MaskCopy::endY((arguments[2] & 0xffff0000) >> 16);
 
+    syncDeferred({}, vramTiles(startX, startY, endX - startX, endY - startY));
+
     cmd = Command::CopyCpuToVram2;
+    handler = &GPU::cmdCpuToVram2;
     argumentCount = 1;
     currentArgument = 0;
 }
 
-void GPU::cmdCpuToVram2(uint8_t command, uint32_t arguments[]) {
-    uint32_t byte = arguments[0];
+void GPU::cmdCpuToVram2(const uint32_t arguments[]) {
+    writeCpuToVram(arguments, 1);
+    currentArgument = 0;
+}
+
+size_t GPU::writeCpuToVram(const uint32_t* data, size_t count) {
+    // Each word holds two pixels
+    const uint16_t* pixels = reinterpret_cast<const uint16_t*>(data);
+    int pixelCount = count * 2;
+    int used = 0;
+
+    while (used < pixelCount && cmd == Command::CopyCpuToVram2) {
+        // Row is split only at VRAM edge
+        int x = currX % VRAM_WIDTH;
+        int n = std::min({endX - currX, VRAM_WIDTH - x, pixelCount - used});
 
-    // TODO: ugly code
-    VRAM[currY % VRAM_HEIGHT][currX++ % VRAM_WIDTH] = byte & 0xffff;
-    if (currX >= endX) {
-        currX = startX;
-        if (++currY >= endY) cmd = Command::None;
+        writeVramRow(x, currY % VRAM_HEIGHT, pixels + used, n);
+        used += n;
+        currX += n;
+
+        if (currX >= endX) {
+            currX = startX;
+            if (++currY >= endY) cmd = Command::None;
+        }
     }
 
-    VRAM[currY % VRAM_HEIGHT][currX++ % VRAM_WIDTH] = (byte >> 16) & 0xffff;
-    if (currX >= endX) {
-        currX = startX;
-        if (++currY >= endY) cmd = Command::None;
+    if (backend && cmd == Command::None) {
+        backend->uploadVram(startX, startY, endX - startX, endY - startY);
     }
 
-    currentArgument = 0;
+    return (used + 1) / 2;
 }
 
-void GPU::cmdVramToCpu(uint8_t command, uint32_t arguments[]) {
+void GPU::writeVramRow(int x, int y, const uint16_t* pixels, int count) {
+    uint16_t maskSet = gp0_e6.setMaskWhileDrawing ? 0x8000 : 0;
+    bool maskCheck = gp0_e6.checkMaskBeforeDraw;
+
+    markVram(x, y, count, 1);
+
+    if (resolutionMultiplier == 1 && !maskSet && !maskCheck) {
+        std::copy_n(pixels, count, &vram[y * VRAM_WIDTH + x]);
+        return;
+    }
+
+    for (int i = 0; i < count; i++) {
+        if (maskCheck && (readVram(x + i, y) & 0x8000)) continue;
+        writeVram(x + i, y, pixels[i] | maskSet);
+    }
+}
+
+void GPU::cmdVramToCpu(const uint32_t arguments[]) {
     if ((arguments[0] & 0x00ffffff) != 0) {
         printf("cmdVramToCpu: Suspicious arg0: 0x%x\n", arguments[0]);
     }
@@ -265,10 +576,16 @@ void GPU::cmdVramToCpu(uint8_t command, uint32_t arguments[]) {
     endX = startX + MaskCopy::endX(arguments[2] & 0xffff);
     endY = startY + MaskCopy::endY((arguments[2] & 0xffff0000) >> 16);
 
+    syncDeferred(vramTiles(startX, startY, endX - startX, endY - startY), {});
+
+    if (backend) {
+        backend->readVram(startX, startY, endX - startX, endY - startY);
+    }
+
     cmd = Command::None;
 }
 
-void GPU::cmdVramToVram(uint8_t command, uint32_t arguments[]) {
+void GPU::cmdVramToVram(const uint32_t arguments[]) {
     if ((arguments[0] & 0x00ffffff) != 0) {
         printf("cpuVramToVram: Suspicious arg0: 0x%x\n", arguments[0]);
     }
@@ -287,9 +604,52 @@ void GPU::cmdVramToVram(uint8_t command, uint32_t arguments[]) {
         return;
     }
 
+    if (backend) {
+        backend->copyVram(srcX, srcY, dstX, dstY, width, height);
+        cmd = Command::None;
+        return;
+    }
+
+    syncDeferred(vramTiles(srcX, srcY, width, height), vramTiles(dstX, dstY, width, height));
+    markVram(dstX, dstY, width, height);
+
+    // Copy is done in internal resolution to preserve upscaled details
+    int scale = resolutionMultiplier;
+    int vramWidth = getVramWidth();
+    int vramHeight = getVramHeight();
+    uint16_t maskSet = gp0_e6.setMaskWhileDrawing ? 0x8000 : 0;
+    bool maskCheck = gp0_e6.checkMaskBeforeDraw;
+
+    srcX *= scale;
+    srcY *= scale;
+    dstX *= scale;
+    dstY *= scale;
+    width *= scale;
+    height *= scale;
+
+    // Like on real hardware rows are copied top to bottom through a line buffer,
+    // so only horizontal overlap is resolved
     for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            VRAM[(dstY + y) % VRAM_HEIGHT][(dstX + x) % VRAM_WIDTH] = VRAM[(srcY + y) % VRAM_HEIGHT][(srcX + x) % VRAM_WIDTH];
+        uint16_t* srcRow = &vram[((srcY + y) % vramHeight) * vramWidth];
+        uint16_t* dstRow = &vram[((dstY + y) % vramHeight) * vramWidth];
+
+        // Span is split only where source or destination wraps around VRAM edge
+        for (int x = 0; x < width;) {
+            int sx = (srcX + x) % vramWidth;
+            int dx = (dstX + x) % vramWidth;
+            int n = std::min({width - x, vramWidth - sx, vramWidth - dx});
+
+            if (!maskSet && !maskCheck) {
+                std::memmove(dstRow + dx, srcRow + sx, n * sizeof(uint16_t));
+            } else {
+                uint16_t line[VRAM_WIDTH * MAX_RESOLUTION_MULTIPLIER];
+                std::copy_n(srcRow + sx, n, line);
+                for (int j = 0; j < n; j++) {
+                    if (maskCheck && (dstRow[dx + j] & 0x8000)) continue;
+                    dstRow[dx + j] = line[j] | maskSet;
+                }
+            }
+            x += n;
         }
     }
 
@@ -336,7 +696,7 @@ uint32_t GPU::read(uint32_t address) {
             return GPUREAD;
         }
         if (gpuReadMode == 1) {
-            uint32_t word = VRAM[currY][currX] | (VRAM[currY][currX + 1] << 16);
+            uint32_t word = readVram(currX % VRAM_WIDTH, currY % VRAM_HEIGHT) | (readVram((currX + 1) % VRAM_WIDTH, currY % VRAM_HEIGHT) << 16);
             currX += 2;
 
             if (currX >= endX) {
@@ -361,204 +721,328 @@ void GPU::write(uint32_t address, uint32_t data) {
     if (reg == 4) writeGP1(data);
 }
 
+void GPU::cmdNop(const uint32_t arguments[]) {}
+
+void GPU::cmdUnknown(const uint32_t arguments[]) { printf("GP0(0x%02x) args 0x%06x\n", command, arguments[0]); }
+
+void GPU::cmdInterruptRequest(const uint32_t arguments[]) {
+    // IRQ is raised on rising edge of GPUSTAT.24, it stays set until GP1(02h)
+    if (!irqRequest) irqPending = true;
+    irqRequest = true;
+}
+
+void GPU::cmdDrawMode(const uint32_t arguments[]) { gp0_e1._reg = arguments[0]; }
+
+void GPU::cmdTextureWindow(const uint32_t arguments[]) { gp0_e2._reg = arguments[0]; }
+
+void GPU::cmdDrawingAreaTopLeft(const uint32_t arguments[]) {
+    drawingArea.left = arguments[0] & 0x3ff;
+    drawingArea.top = (arguments[0] & 0xffc00) >> 10;
+}
+
+void GPU::cmdDrawingAreaBottomRight(const uint32_t arguments[]) {
+    drawingArea.right = arguments[0] & 0x3ff;
+    drawingArea.bottom = (arguments[0] & 0xffc00) >> 10;
+}
+
+void GPU::cmdDrawingOffset(const uint32_t arguments[]) {
+    drawingOffsetX = extend_sign<11>(arguments[0] & 0x7ff);
+    drawingOffsetY = extend_sign<11>((arguments[0] >> 11) & 0x7ff);
+}
+
+void GPU::cmdMaskBit(const uint32_t arguments[]) { gp0_e6._reg = arguments[0]; }
+
+namespace {
+using Flags = GP0Opcode::Flags;
+
+template <int op, typename = void>
+struct GP0Op {
+    static constexpr GP0Opcode get() { return {Command::None, 1, 0, &GPU::cmdUnknown}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op == 0x00 || op == 0x01>> {  // NOP, Clear Cache
+    static constexpr GP0Opcode get() { return {Command::None, 1, 0, &GPU::cmdNop}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op == 0x02>> {
+    static constexpr GP0Opcode get() { return {Command::FillRectangle, 3, Flags::Packet, &GPU::cmdFillRectangle}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op == 0x1f>> {
+    static constexpr GP0Opcode get() { return {Command::None, 1, 0, &GPU::cmdInterruptRequest}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op >= 0x20 && op < 0x40>> {
+    static constexpr int vertices = (op & 0x08) ? 4 : 3;
+    static constexpr int textured = (op & 0x04) ? 1 : 0;
+    static constexpr int shaded = (op & 0x10) ? 1 : 0;
+
+    // Color, then vertex and uv for every vertex, shaded polygons have color before every vertex but the first
+    static constexpr GP0Opcode get() {
+        return {Command::Polygon, (uint8_t)(1 + vertices * (1 + textured + shaded) - shaded), Flags::Packet, &GPU::cmdPolygon<op>};
+    }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op >= 0x40 && op < 0x60 && (op & 0x08) == 0>> {
+    static constexpr GP0Opcode get() { return {Command::Line, (uint8_t)((op & 0x10) ? 4 : 3), Flags::Packet, &GPU::cmdLine<op>}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op >= 0x40 && op < 0x60 && (op & 0x08) != 0>> {  // Polyline, streamed word by word
+    static constexpr GP0Opcode get() { return {Command::Line, 1, 0, &GPU::cmdPolylineStart}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op >= 0x60 && op < 0x80>> {
+    static constexpr int variableSize = ((op >> 3) & 3) == 0 ? 1 : 0;
+    static constexpr int textured = (op & 0x04) ? 1 : 0;
+
+    static constexpr GP0Opcode get() {
+        return {Command::Rectangle, (uint8_t)(2 + variableSize + textured), Flags::Packet, &GPU::cmdRectangle<op>};
+    }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op == 0x80>> {
+    static constexpr GP0Opcode get() { return {Command::CopyVramToVram, 4, Flags::Packet, &GPU::cmdVramToVram}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op == 0xa0>> {
+    static constexpr GP0Opcode get() { return {Command::CopyCpuToVram1, 3, 0, &GPU::cmdCpuToVram1}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op == 0xc0>> {
+    static constexpr GP0Opcode get() { return {Command::CopyVramToCpu, 3, 0, &GPU::cmdVramToCpu}; }
+};
+
+template <int op>
+struct GP0Op<op, std::enable_if_t<op >= 0xe1 && op <= 0xe6>> {
+    static constexpr GP0Opcode::Handler handler() {
+        return op == 0xe1 ? &GPU::cmdDrawMode
+                          : op == 0xe2 ? &GPU::cmdTextureWindow
+                                       : op == 0xe3 ? &GPU::cmdDrawingAreaTopLeft
+                                                    : op == 0xe4 ? &GPU::cmdDrawingAreaBottomRight
+                                                                 : op == 0xe5 ? &GPU::cmdDrawingOffset : &GPU::cmdMaskBit;
+    }
+    static constexpr GP0Opcode get() { return {Command::None, 1, 0, handler()}; }
+};
+
+template <size_t... op>
+constexpr std::array<GP0Opcode, 256> makeGP0Table(std::index_sequence<op...>) {
+    return {{GP0Op<op>::get()...}};
+}
+
+constexpr std::array<GP0Opcode, 256> gp0Opcodes = makeGP0Table(std::make_index_sequence<256>());
+
+static_assert(gp0Opcodes[0x3c].words == 12, "Shaded textured quad takes 12 words");
+static_assert(gp0Opcodes[0x64].words == 4, "Textured variable size rectangle takes 4 words");
+}  // namespace
+
 void GPU::writeGP0(uint32_t data) {
     if (cmd == Command::None) {
         command = data >> 24;
         arguments[0] = data & 0xffffff;
-        argumentCount = 0;
-        currentArgument = 1;
 
-        if (command == 0x00) {
-            // NOP
-        } else if (command == 0x01) {
-            // Clear Cache
-        } else if (command == 0x02) {
-            // Fill rectangle
-            cmd = Command::FillRectangle;
-            argumentCount = 2;
-        } else if (command >= 0x20 && command < 0x40) {
-            // Polygons
-            cmd = Command::Polygon;
-            argumentCount = PolygonArgs(command).getArgumentCount();
-        } else if (command >= 0x40 && command < 0x60) {
-            // Lines
-            cmd = Command::Line;
-            argumentCount = LineArgs(command).getArgumentCount();
-        } else if (command >= 0x60 && command < 0x80) {
-            // Rectangles
-            cmd = Command::Rectangle;
-            argumentCount = RectangleArgs(command).getArgumentCount();
-        } else if (command == 0xa0) {
-            // Copy rectangle (CPU -> VRAM)
-            cmd = Command::CopyCpuToVram1;
-            argumentCount = 2;
-        } else if (command == 0xc0) {
-            // Copy rectangle (VRAM -> CPU)
-            cmd = Command::CopyVramToCpu;
-            argumentCount = 2;
-        } else if (command == 0x80) {
-            // Copy rectangle (VRAM -> VRAM)
-            cmd = Command::CopyVramToVram;
-            argumentCount = 3;
-        } else if (command == 0xe1) {
-            // Draw mode setting
-            gp0_e1._reg = arguments[0];
-        } else if (command == 0xe2) {
-            // Texture window setting
-            gp0_e2._reg = arguments[0];
-        } else if (command == 0xe3) {
-            // Drawing area top left
-            drawingArea.left = arguments[0] & 0x3ff;
-            drawingArea.top = (arguments[0] & 0xffc00) >> 10;
-        } else if (command == 0xe4) {
-            // Drawing area bottom right
-            drawingArea.right = arguments[0] & 0x3ff;
-            drawingArea.bottom = (arguments[0] & 0xffc00) >> 10;
-        } else if (command == 0xe5) {
-            // Drawing offset
-            drawingOffsetX = extend_sign<11>(arguments[0] & 0x7ff);
-            drawingOffsetY = extend_sign<11>((arguments[0] >> 11) & 0x7ff);
-        } else if (command == 0xe6) {
-            // Mask bit setting
-            gp0_e6._reg = arguments[0];
-        } else if (command == 0x1f) {
-            // Interrupt request
-            irqRequest = true;
-            // TODO: IRQ
-        } else {
-            printf("GP0(0x%02x) args 0x%06x\n", command, arguments[0]);
-        }
+        const GP0Opcode& op = gp0Opcodes[command];
+        if (op.words == 1) {
+            if (gpuLogEnabled && op.cmd == Command::None) {
+                gpuLog.push(command, Command::Extra, arguments, 1);
+            }
 
-        if (gpuLogEnabled && cmd == Command::None) {
-            GPU_LOG_ENTRY entry;
-            entry.cmd = Command::Extra;
-            entry.command = command;
-            entry.args = std::vector<uint32_t>();
-            entry.args.push_back(arguments[0]);
-            gpuLogList.push_back(entry);
+            // Drawing state changes are part of open batch, new drawing area starts a new one
+            if (command == 0xe3 || command == 0xe4) {
+                batchOpen = false;
+            } else if (batchOpen && command >= 0xe1 && command <= 0xe6) {
+                deferred.back().words.push_back(data);
+            }
+
+            (this->*op.handler)(arguments);
+            return;
         }
-        // if (cmd == Command::None) printf("GPU: 0x%02x\n", command);
 
-        argumentCount++;
+        cmd = op.cmd;
+        handler = op.handler;
+        argumentCount = op.words;
+        currentArgument = 1;
+        return;
+    }
+
+    if (polyline.active) {
+        writePolyline(&data, 1);
         return;
     }
 
     if (currentArgument < argumentCount) {
         arguments[currentArgument++] = data;
-        if (argumentCount == MAX_ARGS && (data == 0x50005000 || data == 0x55555555)) argumentCount = currentArgument;
         if (currentArgument != argumentCount) return;
     }
 
+    executeCommand(arguments);
+}
+
+void GPU::executeCommand(const uint32_t arguments[]) {
     if (gpuLogEnabled && cmd != Command::CopyCpuToVram2) {
-        GPU_LOG_ENTRY entry;
-        entry.cmd = cmd;
-        entry.command = command;
-        entry.args = std::vector<uint32_t>(arguments, arguments + argumentCount);
-        gpuLogList.push_back(entry);
-    }
-
-    // printf("%s(0x%x)\n", CommandStr[(int)cmd], command);
-
-    if (cmd == Command::FillRectangle)
-        cmdFillRectangle(command, arguments);
-    else if (cmd == Command::Polygon)
-        cmdPolygon(command, arguments);
-    else if (cmd == Command::Line)
-        cmdLine(command, arguments);
-    else if (cmd == Command::Rectangle)
-        cmdRectangle(command, arguments);
-    else if (cmd == Command::CopyCpuToVram1)
-        cmdCpuToVram1(command, arguments);
-    else if (cmd == Command::CopyCpuToVram2)
-        cmdCpuToVram2(command, arguments);
-    else if (cmd == Command::CopyVramToCpu)
-        cmdVramToCpu(command, arguments);
-    else if (cmd == Command::CopyVramToVram)
-        cmdVramToVram(command, arguments);
+        gpuLog.push(command, cmd, arguments, argumentCount);
+    }
+
+    if ((cmd == Command::Polygon || cmd == Command::Line || cmd == Command::Rectangle)
+        && deferPrimitive(cmd, command, arguments, argumentCount)) {
+        cmd = Command::None;
+        return;
+    }
+
+    (this->*handler)(arguments);
 }
 
-void GPU::writeGP1(uint32_t data) {
-    uint32_t command = (data >> 24) & 0x3f;
-    uint32_t argument = data & 0xffffff;
+size_t GPU::replayCommand(const uint32_t* data) {
+    const GP0Opcode& op = gp0Opcodes[data[0] >> 24];
 
-    if (command == 0x00) {  // Reset GPU
-        reset();
-    } else if (command == 0x01) {  // Reset command buffer
-
-    } else if (command == 0x02) {  // Acknowledge IRQ1
-        irqRequest = false;
-    } else if (command == 0x03) {  // Display Enable
-        displayDisable = (Bit)(argument & 1);
-    } else if (command == 0x04) {  // DMA Direction
-        dmaDirection = argument & 3;
-    } else if (command == 0x05) {  // Start of display area
-        displayAreaStartX = argument & 0x3ff;
-        displayAreaStartY = argument >> 10;
-    } else if (command == 0x06) {  // Horizontal display range
-        displayRangeX1 = argument & 0xfff;
-        displayRangeX2 = argument >> 12;
-    } else if (command == 0x07) {  // Vertical display range
-        displayRangeY1 = argument & 0x3ff;
-        displayRangeX2 = argument >> 10;
-    } else if (command == 0x08) {  // Display mode
-        gp1_08._reg = argument;
-    } else if (command == 0x09) {  // Allow texture disable
-        textureDisableAllowed = argument & 1;
-    } else if (command >= 0x10 && command <= 0x1f) {  // get GPU Info
-        gpuReadMode = 2;
-        argument &= 0xf;
-
-        if (argument == 2) {
-            GPUREAD = gp0_e2._reg;
-        } else if (argument == 3) {
-            GPUREAD = (drawingArea.top << 10) | drawingArea.left;
-        } else if (argument == 4) {
-            GPUREAD = (drawingArea.bottom << 10) | drawingArea.right;
-        } else if (argument == 5) {
-            GPUREAD = (drawingOffsetY << 11) | drawingOffsetX;
-        } else if (argument == 7) {
-            GPUREAD = 2;  // GPU Version
-        } else if (argument == 8) {
-            GPUREAD = 0;
+    // Longest packet (shaded textured quad) takes 12 words
+    uint32_t args[16];
+    args[0] = data[0] & 0xffffff;
+    std::copy_n(data + 1, op.words - 1, args + 1);
+    (this->*op.handler)(args);
+    return op.words;
+}
+
+size_t GPU::decodePacket(const uint32_t* data, size_t count) {
+    uint8_t command = data[0] >> 24;
+    const GP0Opcode& op = gp0Opcodes[command];
+
+    // Other commands go through writeGP0
+    if (!(op.flags & GP0Opcode::Packet) || op.words > count) return 0;
+
+    this->command = command;
+    cmd = op.cmd;
+    handler = op.handler;
+    argumentCount = op.words;
+    executeCommand(data);
+    return op.words;
+}
+
+void GPU::writeGP0Block(const uint32_t* data, size_t count) {
+    while (count > 0) {
+        size_t n = 0;
+        if (cmd == Command::CopyCpuToVram2) {
+            n = writeCpuToVram(data, count);
+        } else if (polyline.active) {
+            n = writePolyline(data, count);
+        } else if (cmd == Command::None) {
+            n = decodePacket(data, count);
+        }
+
+        if (n > 0) {
+            data += n;
+            count -= n;
         } else {
-            // GPUREAD unchanged
+            writeGP0(*data++);
+            count--;
         }
+    }
+}
+
+void GPU::readGpuInfo(uint32_t info) {
+    gpuReadMode = 2;
+
+    if (info == 2) {
+        GPUREAD = gp0_e2._reg;
+    } else if (info == 3) {
+        GPUREAD = (drawingArea.top << 10) | drawingArea.left;
+    } else if (info == 4) {
+        GPUREAD = (drawingArea.bottom << 10) | drawingArea.right;
+    } else if (info == 5) {
+        GPUREAD = (drawingOffsetY << 11) | drawingOffsetX;
+    } else if (info == 7) {
+        GPUREAD = 2;  // GPU Version
+    } else if (info == 8) {
+        GPUREAD = 0;
     } else {
-        printf("GP1(0x%02x) args 0x%06x\n", command, argument);
-        assert(false);
+        // GPUREAD unchanged
     }
-    // command 0x20 is not implemented
 }
 
-bool GPU::emulateGpuCycles(int cycles) {
-    const int LINE_VBLANK_START_NTSC = 243;
-    const int LINES_TOTAL_NTSC = 263;
-    static int gpuLine = 0;
-    static int gpuDot = 0;
+void GPU::writeGP1(uint32_t data) {
+    uint32_t command = (data >> 24) & 0x3f;
+    uint32_t argument = data & 0xffffff;
 
-    gpuDot += cycles;
+    switch (command) {
+        case 0x00:  // Reset GPU
+            reset();
+            break;
+        case 0x01:  // Reset command buffer
+            break;
+        case 0x02:  // Acknowledge IRQ1
+            irqRequest = false;
+            break;
+        case 0x03:  // Display Enable
+            displayDisable = (Bit)(argument & 1);
+            break;
+        case 0x04:  // DMA Direction
+            dmaDirection = argument & 3;
+            break;
+        case 0x05:  // Start of display area
+            displayAreaStartX = argument & 0x3ff;
+            displayAreaStartY = argument >> 10;
+            break;
+        case 0x06:  // Horizontal display range
+            displayRangeX1 = argument & 0xfff;
+            displayRangeX2 = argument >> 12;
+            updateTiming();
+            break;
+        case 0x07:  // Vertical display range
+            displayRangeY1 = argument & 0x3ff;
+            displayRangeY2 = (argument >> 10) & 0x3ff;
+            updateTiming();
+            break;
+        case 0x08:  // Display mode
+            gp1_08._reg = argument;
+            updateTiming();
+            break;
+        case 0x09:  // Allow texture disable
+            textureDisableAllowed = argument & 1;
+            break;
+        default:
+            if (command >= 0x10 && command <= 0x1f) {  // get GPU Info
+                readGpuInfo(argument & 0xf);
+                break;
+            }
+            printf("GP1(0x%02x) args 0x%06x\n", command, argument);
+            assert(false);
+            break;
+    }
+    // command 0x20 is not implemented
+}
 
-    int newLines = gpuDot / 3413;
-    if (newLines == 0) return false;
-    gpuDot %= 3413;
-    gpuLine += newLines;
+bool GPU::emulateGpuCycles(int cpuCycles) {
+    // GPU clock is 11/7 of CPU clock, fraction is carried to next call
+    int ticks = cpuCycles * 11 + clockRemainder;
+    clockRemainder = ticks % 7;
 
-    if (gpuLine < LINE_VBLANK_START_NTSC - 1) {
-        if (gp1_08.verticalResolution == GP1_08::VerticalResolution::r480 && gp1_08.interlace) {
-            odd = (frames % 2) != 0;
-        } else {
-            odd = (gpuLine % 2) != 0;
-        }
-    } else {
+    bool vblank = timing.step(ticks / 7);
+
+    // GPUSTAT.31: field being displayed in interlaced 480 line mode, otherwise changes every line, always 0 in vblank
+    if (timing.inVblank()) {
         odd = false;
+    } else if (gp1_08.verticalResolution == GP1_08::VerticalResolution::r480 && gp1_08.interlace) {
+        odd = timing.oddField;
+    } else {
+        odd = (timing.line % 2) != 0;
     }
 
-    if (gpuLine == LINES_TOTAL_NTSC - 1) {
-        gpuLine = 0;
-        frames++;
-        return true;
-    }
-    return false;
+    if (vblank) frames++;
+    return vblank;
+}
+
+void GPU::updateTiming() {
+    timing.configure(!isNtsc(), gp1_08.interlace, gp1_08.getHorizontalResoulution(), displayRangeX1, displayRangeX2, displayRangeY1,
+                     displayRangeY2);
 }
 
 bool GPU::isNtsc() { return gp1_08.videoMode == GP1_08::VideoMode::ntsc; }
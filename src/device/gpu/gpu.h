@@ -1,17 +1,33 @@
 #pragma once
+#include <algorithm>
+#include <array>
+#include <bitset>
 #include <glm/glm.hpp>
+#include <string>
 #include <vector>
+#include "command_log.h"
 #include "psx_color.h"
 #include "registers.h"
+#include "video_timing.h"
 
-const int MAX_ARGS = 32;
 
 extern const char* CommandStr[];
 
 const int VRAM_WIDTH = 1024;
 const int VRAM_HEIGHT = 512;
 
-#define VRAM ((uint16_t(*)[VRAM_WIDTH])vram.data())
+const int MAX_RESOLUTION_MULTIPLIER = 4;
+
+// VRAM is tracked in 64x64 tiles (native coordinates)
+const int VRAM_TILE_SIZE = 64;
+const int VRAM_TILES_X = VRAM_WIDTH / VRAM_TILE_SIZE;
+const int VRAM_TILES_Y = VRAM_HEIGHT / VRAM_TILE_SIZE;
+const int VRAM_TILE_COUNT = VRAM_TILES_X * VRAM_TILES_Y;
+
+using VramTiles = std::bitset<VRAM_TILE_COUNT>;
+
+// Tiles covered by area (native coordinates, wraps around VRAM edges)
+VramTiles vramTiles(int x, int y, int w, int h);
 
 union PolygonArgs {
     struct {
@@ -50,11 +66,8 @@ union LineArgs {
 
     LineArgs(uint8_t arg) : _(arg) {}
 
-    int getArgumentCount() const {
-        if (polyLine) return MAX_ARGS - 1;
-
-        return 2 + (gouroudShading ? 1 : 0);
-    }
+    // Polyline has no fixed length, this is the size of its first segment
+    int getArgumentCount() const { return 2 + (gouroudShading ? 1 : 0); }
 };
 
 union RectangleArgs {
@@ -106,6 +119,7 @@ struct Vertex {
      *          ^
      *          Transparency enabled (yes for tris, no for rect)
      */
+    int textureWindow[4];  // mask x, mask y, offset x, offset y (GP0_E2)
 };
 
 struct TextureInfo {
@@ -144,12 +158,55 @@ struct TextureInfo {
     GP0_E1::SemiTransparency semiTransparencyBlending() const { return (GP0_E1::SemiTransparency)((texpage & 0x600000) >> 21); }
 };
 
+/**
+ * Interface for renderers that keep VRAM on their own (eg. OpenGL hardware renderer).
+ * When attached to GPU primitives and VRAM transfers are forwarded to it
+ * instead of being rasterized in software.
+ * Calls are made synchronously from GP0 command handlers, in command order.
+ */
+class RenderBackend {
+   public:
+    virtual ~RenderBackend() {}
+
+    // Vertices are already offset by drawing offset, count is a multiple of 3
+    virtual void drawTriangles(const Vertex* v, int count) = 0;
+    virtual void drawLine(const Vertex v[2]) = 0;
+    virtual void fillRectangle(int x, int y, int w, int h, uint16_t color) = 0;
+
+    // Area of gpu->vram has been written by CPU
+    virtual void uploadVram(int x, int y, int w, int h) = 0;
+    virtual void copyVram(int srcX, int srcY, int dstX, int dstY, int w, int h) = 0;
+
+    // Area of gpu->vram is going to be read by CPU and has to be synchronized
+    virtual void readVram(int x, int y, int w, int h) = 0;
+};
+
+struct GPU;
+
+/**
+ * Entry of GP0 opcode table, the table is generated at compile time from opcode bits (see gpu.cpp).
+ * Every drawing opcode variant has its own handler instance with flags resolved by template.
+ */
+struct GP0Opcode {
+    enum Flags : uint8_t {
+        Packet = 1 << 0,  // Can be executed directly from complete packet in memory (DMA)
+    };
+    using Handler = void (GPU::*)(const uint32_t arguments[]);
+
+    Command cmd;  // Command::None for opcodes executed right away
+    uint8_t words;  // Including command word
+    uint8_t flags;
+    Handler handler;
+};
+
 struct GPU {
     /* 0 - nothing
        1 - GP0(0xc0) - VRAM to CPU transfer
        2 - GP1(0x10) - Get GPU Info
     */
 
+    // Internal resolution of software renderer,
+    // vram is stored as (VRAM_WIDTH * resolutionMultiplier) x (VRAM_HEIGHT * resolutionMultiplier)
     int resolutionMultiplier = 1;
 
     int startX = 0;
@@ -163,11 +220,22 @@ struct GPU {
     uint32_t GPUSTAT = 0;
 
     Command cmd = Command::None;
+    GP0Opcode::Handler handler = nullptr;  // Handler of current command
     uint8_t command = 0;
     uint32_t arguments[33];
     int currentArgument = 0;
     int argumentCount = 0;
 
+    // Polyline is rasterized segment by segment as its words arrive, until terminator (0x5xxx5xxx)
+    struct {
+        bool active = false;
+        bool expectColor = false;  // Gouraud shaded polyline sends color before every vertex
+        int vertices = 0;
+        uint32_t color = 0;     // Color of last vertex
+        uint32_t position = 0;  // Last vertex
+        uint32_t nextColor = 0;
+    } polyline;
+
     GP0_E1 gp0_e1;
     GP0_E2 gp0_e2;
 
@@ -184,6 +252,14 @@ struct GPU {
 
     // GP1(0x02)
     bool irqRequest;
+    bool irqPending = false;  // Raised by GP0(1Fh), not yet passed to interrupt controller
+
+    // Returns true once after GP0(1Fh) requested IRQ
+    bool pollIrq() {
+        bool pending = irqPending;
+        irqPending = false;
+        return pending;
+    }
 
     // GP1(0x03)
     bool displayDisable;
@@ -209,51 +285,173 @@ struct GPU {
     bool textureDisableAllowed = false;
 
     void reset();
-    void cmdFillRectangle(uint8_t command, uint32_t arguments[]);
-    void cmdPolygon(PolygonArgs arg, uint32_t arguments[]);
-    void cmdLine(LineArgs arg, uint32_t arguments[]);
-    void cmdRectangle(RectangleArgs arg, uint32_t arguments[]);
-    void cmdCpuToVram1(uint8_t command, uint32_t arguments[]);
-    void cmdCpuToVram2(uint8_t command, uint32_t arguments[]);
-    void cmdVramToCpu(uint8_t command, uint32_t arguments[]);
-    void cmdVramToVram(uint8_t command, uint32_t arguments[]);
+    void cmdNop(const uint32_t arguments[]);
+    void cmdUnknown(const uint32_t arguments[]);
+    void cmdInterruptRequest(const uint32_t arguments[]);
+    void cmdDrawMode(const uint32_t arguments[]);
+    void cmdTextureWindow(const uint32_t arguments[]);
+    void cmdDrawingAreaTopLeft(const uint32_t arguments[]);
+    void cmdDrawingAreaBottomRight(const uint32_t arguments[]);
+    void cmdDrawingOffset(const uint32_t arguments[]);
+    void cmdMaskBit(const uint32_t arguments[]);
+    void cmdFillRectangle(const uint32_t arguments[]);
+    template <uint8_t command>
+    void cmdPolygon(const uint32_t arguments[]);
+    template <uint8_t command>
+    void cmdLine(const uint32_t arguments[]);
+    void cmdPolylineStart(const uint32_t arguments[]);
+    void drawLineSegment(LineArgs arg, uint32_t color0, uint32_t position0, uint32_t color1, uint32_t position1);
+    template <uint8_t command>
+    void cmdRectangle(const uint32_t arguments[]);
+    void cmdCpuToVram1(const uint32_t arguments[]);
+    void cmdCpuToVram2(const uint32_t arguments[]);
+    void cmdVramToCpu(const uint32_t arguments[]);
+    void cmdVramToVram(const uint32_t arguments[]);
 
     void drawPolygon(int16_t x[4], int16_t y[4], RGB c[4], TextureInfo t, bool isQuad = false, bool textured = false, int flags = 0);
 
     void writeGP0(uint32_t data);
     void writeGP1(uint32_t data);
+    void readGpuInfo(uint32_t info);
+
+    // Used by DMA2, complete packets are decoded in place and data words of CPU to VRAM transfers are copied in bulk
+    void writeGP0Block(const uint32_t* data, size_t count);
+
+    // Consumes polyline words, returns number of words used
+    size_t writePolyline(const uint32_t* data, size_t count);
 
+    // Executes whole drawing packet directly from data, returns number of words used or 0 if packet is incomplete
+    size_t decodePacket(const uint32_t* data, size_t count);
+
+    // Logs and executes current command with all of its arguments gathered
+    void executeCommand(const uint32_t arguments[]);
+
+    // Executes complete command from data without touching command parser, returns number of words used
+    size_t replayCommand(const uint32_t* data);
+
+    // Returns number of words consumed by current CPU to VRAM transfer
+    size_t writeCpuToVram(const uint32_t* data, size_t count);
+
+    // Writes pixel run that doesn't cross VRAM edge, honours mask bit settings
+    void writeVramRow(int x, int y, const uint16_t* pixels, int count);
+
+    // Scaled (internal resolution) coordinates
     int minDrawingX(int x) const;
     int minDrawingY(int y) const;
     int maxDrawingX(int x) const;
     int maxDrawingY(int y) const;
+
+    // Native coordinates
     bool insideDrawingArea(int x, int y) const;
 
+    // Marks bounding box of primitive (inclusive, native coordinates) clipped to drawing area
+    void markDrawing(int x0, int y0, int x1, int y1);
+
     bool odd = false;
     int frames = 0;
 
-    GPU() {
-        vram.resize(VRAM_WIDTH * VRAM_HEIGHT * resolutionMultiplier);
-        prevVram.resize(VRAM_WIDTH * VRAM_HEIGHT * resolutionMultiplier);
-    }
+    GPU();
     void step();
     uint32_t read(uint32_t address);
     void write(uint32_t address, uint32_t data);
 
-    bool emulateGpuCycles(int cycles);
+    // Advances video timing by CPU cycles, returns true when vblank starts
+    bool emulateGpuCycles(int cpuCycles);
+
+    VideoTiming timing;
+    int clockRemainder = 0;  // CPU cycles * 11 not yet converted to GPU cycles (in 1/7 of GPU cycle)
+    void updateTiming();
 
     bool isNtsc();
 
     std::vector<uint16_t> vram;
+
+    // Copy-on-write backup of tiles modified in current frame (valid only for tiles set in frameTiles)
     std::vector<uint16_t> prevVram;
 
-    struct GPU_LOG_ENTRY {
-        uint8_t command;
-        Command cmd;
-        std::vector<uint32_t> args;
+    // Tiles written since last clearDirtyTiles() (eg. for renderer uploads)
+    std::bitset<VRAM_TILE_COUNT> dirtyTiles;
+
+    // Tiles written since beginFrame()
+    std::bitset<VRAM_TILE_COUNT> frameTiles;
+
+    // If enabled, tiles are backed up to prevVram before first write in a frame (used by debugger replay)
+    bool backupVram = false;
+    bool backupValid = false;
+
+    // Must be called before modifying VRAM area (native coordinates, wraps around VRAM edges)
+    void markVram(int x, int y, int w, int h);
+    void clearDirtyTiles() { dirtyTiles.reset(); }
+
+    // GP0(E1h..E6h) words recreating current drawing state
+    using DrawingState = std::array<uint32_t, 6>;
+    DrawingState getDrawingState() const;
+    DrawingState frameStartState = {};
+
+    void beginFrame();
+
+    // Restores VRAM and drawing state from beginning of the frame, returns false if backup is not available
+    bool restoreFrameStart();
+
+    // Frame skipping (software rasterizer only): while set, primitives are queued instead of being rasterized.
+    // Queued batches are rasterized in order as soon as their output could be observed (VRAM transfers, fills,
+    // other primitives, display), batches completely overwritten by a fill are dropped without ever being drawn.
+    bool skipRendering = false;
+
+    struct DeferredBatch {
+        DrawingState state;           // Drawing state at the beginning of the batch
+        std::vector<uint32_t> words;  // Primitives and drawing state changes, as written to GP0
+        Rect<int> area;               // Clipped drawing area, primitives don't write outside of it
+        VramTiles drawTiles;
+        VramTiles readTiles;  // Texture pages and CLUTs
     };
+    std::vector<DeferredBatch> deferred;
+    bool batchOpen = false;  // New batch is started when drawing area changes
 
+    // Returns true if primitive was queued, otherwise it has to be drawn right away
+    bool deferPrimitive(Command type, uint8_t command, const uint32_t arguments[], int count);
+
+    // Rasterizes queued batches which have to be visible before VRAM access, cover is area that is going to be completely overwritten
+    void syncDeferred(const VramTiles& read, const VramTiles& write, const Rect<int>* cover = nullptr);
+
+    // Rasterizes first count batches
+    void flushDeferred(size_t count = SIZE_MAX);
+
+    // Rasterizes batches visible in display area
+    void flushDeferredDisplay();
+
+    // Resamples vram to new internal resolution
+    void setResolutionMultiplier(int multiplier);
+    int getVramWidth() const { return VRAM_WIDTH * resolutionMultiplier; }
+    int getVramHeight() const { return VRAM_HEIGHT * resolutionMultiplier; }
+
+    // Access VRAM using native (1024x512) coordinates
+    uint16_t readVram(int x, int y) const { return vram[(y * getVramWidth() + x) * resolutionMultiplier]; }
+
+    void writeVram(int x, int y, uint16_t color) {
+        if (resolutionMultiplier == 1) {
+            vram[y * VRAM_WIDTH + x] = color;
+            return;
+        }
+        int width = getVramWidth();
+        uint16_t* block = &vram[(y * width + x) * resolutionMultiplier];
+        for (int i = 0; i < resolutionMultiplier; i++) {
+            std::fill_n(block + i * width, resolutionMultiplier, color);
+        }
+    }
+
+    // Hardware renderer, software rasterizer is used if nullptr
+    RenderBackend* backend = nullptr;
+
+#ifdef NDEBUG
+    bool gpuLogEnabled = false;
+#else
     bool gpuLogEnabled = true;
+#endif
+
+    CommandLog gpuLog;
 
-    std::vector<GPU_LOG_ENTRY> gpuLogList;
+    // Binary capture of current frame - VRAM at its beginning and logged GP0 commands
+    bool saveLogCapture(const std::string& path) const;
+    bool loadLogCapture(const std::string& path);
 };
\ No newline at end of file
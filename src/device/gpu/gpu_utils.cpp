@@ -1,15 +1,40 @@
 #include <algorithm>
 #include "gpu.h"
 
-int GPU::minDrawingX(int x) const { return std::max((int)drawingArea.left, std::max(0, x)); }
+int GPU::minDrawingX(int x) const { return std::max(drawingArea.left * resolutionMultiplier, std::max(0, x)); }
 
-int GPU::minDrawingY(int y) const { return std::max((int)drawingArea.top, std::max(0, y)); }
+int GPU::minDrawingY(int y) const { return std::max(drawingArea.top * resolutionMultiplier, std::max(0, y)); }
 
-int GPU::maxDrawingX(int x) const { return std::min((int)drawingArea.right, std::min(VRAM_WIDTH, x)); }
+int GPU::maxDrawingX(int x) const { return std::min(drawingArea.right * resolutionMultiplier, std::min(getVramWidth(), x)); }
 
-int GPU::maxDrawingY(int y) const { return std::min((int)drawingArea.bottom, std::min(VRAM_HEIGHT, y)); }
+int GPU::maxDrawingY(int y) const { return std::min(drawingArea.bottom * resolutionMultiplier, std::min(getVramHeight(), y)); }
 
 bool GPU::insideDrawingArea(int x, int y) const {
     return (x >= drawingArea.left) && (x < drawingArea.right) && (x < VRAM_WIDTH) && (y >= drawingArea.top) && (y < drawingArea.bottom)
            && (y < VRAM_HEIGHT);
-}
\ No newline at end of file
+}
+
+void GPU::markDrawing(int x0, int y0, int x1, int y1) {
+    int left = std::max<int>({x0, drawingArea.left, 0});
+    int top = std::max<int>({y0, drawingArea.top, 0});
+    int right = std::min<int>({x1 + 1, drawingArea.right, VRAM_WIDTH});
+    int bottom = std::min<int>({y1 + 1, drawingArea.bottom, VRAM_HEIGHT});
+    markVram(left, top, right - left, bottom - top);
+}
+
+VramTiles vramTiles(int x, int y, int w, int h) {
+    VramTiles tiles;
+    if (w <= 0 || h <= 0) return tiles;
+
+    int tx0 = x / VRAM_TILE_SIZE;
+    int ty0 = y / VRAM_TILE_SIZE;
+    int tilesX = std::min((x + w - 1) / VRAM_TILE_SIZE - tx0 + 1, VRAM_TILES_X);
+    int tilesY = std::min((y + h - 1) / VRAM_TILE_SIZE - ty0 + 1, VRAM_TILES_Y);
+
+    for (int ty = ty0; ty < ty0 + tilesY; ty++) {
+        for (int tx = tx0; tx < tx0 + tilesX; tx++) {
+            tiles.set((ty % VRAM_TILES_Y) * VRAM_TILES_X + (tx % VRAM_TILES_X));
+        }
+    }
+    return tiles;
+}
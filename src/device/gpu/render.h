@@ -1,5 +1,8 @@
 #pragma once
+#include "color_lut.h"
 #include "gpu.h"
+#include "psx_color.h"
 
-void drawLine(GPU* gpu, const int16_t x[2], const int16_t y[2], const RGB c[2]);
-void drawTriangle(GPU* gpu, Vertex v[3]);
\ No newline at end of file
+void drawLine(GPU* gpu, const Vertex v[2]);
+void drawTriangle(GPU* gpu, Vertex v[3]);
+void drawRectangle(GPU* gpu, int16_t x, int16_t y, int16_t w, int16_t h, RGB color, const TextureInfo& tex, bool textured, int flags);
@@ -1,41 +1,103 @@
 #include <algorithm>
+#include "psx_color.h"
 #include "render.h"
 
-#undef VRAM
-#define VRAM ((uint16_t(*)[VRAM_WIDTH])gpu->vram.data())
-
-void drawLine(GPU* gpu, const int16_t x[2], const int16_t y[2], const RGB c[2]) {
-    int x0 = x[0] + gpu->drawingOffsetX;
-    int y0 = y[0] + gpu->drawingOffsetY;
-    int x1 = x[1] + gpu->drawingOffsetX;
-    int y1 = y[1] + gpu->drawingOffsetY;
+namespace {
+// First i in [0, n] for which monotonic (false -> true) predicate holds, n + 1 if none
+template <typename F>
+int firstTrue(int n, F pred) {
+    int lo = 0, hi = n + 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (pred(mid)) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
 
-    bool steep = false;
-    if (std::abs(x0 - x1) < std::abs(y0 - y1)) {
-        std::swap(x0, y0);
-        std::swap(x1, y1);
-        steep = true;
+// Range of steps [first, last) for which coordinate c(i) lies in [lo, hi), c must be monotonic
+template <typename F>
+void clipAxis(int steps, int step, int lo, int hi, F c, int& first, int& last) {
+    if (step >= 0) {
+        first = std::max(first, firstTrue(steps, [&](int i) { return c(i) >= lo; }));
+        last = std::min(last, firstTrue(steps, [&](int i) { return c(i) >= hi; }));
+    } else {
+        first = std::max(first, firstTrue(steps, [&](int i) { return c(i) < hi; }));
+        last = std::min(last, firstTrue(steps, [&](int i) { return c(i) < lo; }));
     }
-    if (x0 > x1) {
-        std::swap(x0, x1);
-        std::swap(y0, y1);
+}
+}  // namespace
+
+/**
+ * Fixed point DDA, positions in 16.16 and colors in 8.12.
+ * Line is clipped once against drawing area by finding range of steps that lands inside of it.
+ */
+void drawLine(GPU* gpu, const Vertex v[2]) {
+    int x0 = v[0].position[0], y0 = v[0].position[1];
+    int dx = v[1].position[0] - x0;
+    int dy = v[1].position[1] - y0;
+
+    // Hardware skips lines that are too long
+    if (std::abs(dx) >= 1024 || std::abs(dy) >= 512) return;
+
+    int steps = std::max(std::abs(dx), std::abs(dy));
+    int stepX = steps ? dx * 65536 / steps : 0;
+    int stepY = steps ? dy * 65536 / steps : 0;
+
+    // Error of divided step is below 1/2 pixel over whole line, so endpoints are exact
+    auto xAt = [&](int i) { return (x0 * 65536 + 0x8000 + stepX * i) >> 16; };
+    auto yAt = [&](int i) { return (y0 * 65536 + 0x8000 + stepY * i) >> 16; };
+
+    int left = std::max<int>(gpu->drawingArea.left, 0);
+    int top = std::max<int>(gpu->drawingArea.top, 0);
+    int right = std::min<int>(gpu->drawingArea.right, VRAM_WIDTH);
+    int bottom = std::min<int>(gpu->drawingArea.bottom, VRAM_HEIGHT);
+
+    int first = 0, last = steps + 1;
+    clipAxis(steps, stepX, left, right, xAt, first, last);
+    clipAxis(steps, stepY, top, bottom, yAt, first, last);
+    if (first >= last) return;
+
+    gpu->markVram(std::min(xAt(first), xAt(last - 1)), std::min(yAt(first), yAt(last - 1)), std::abs(xAt(last - 1) - xAt(first)) + 1,
+                  std::abs(yAt(last - 1) - yAt(first)) + 1);
+
+    bool shaded = v[0].flags & Vertex::GouroudShading;
+    bool dithered = shaded && (v[0].flags & Vertex::Dithering);
+    bool semiTransparent = v[0].flags & Vertex::SemiTransparency;
+    auto transparency = (GP0_E1::SemiTransparency)((v[0].flags & 0x60) >> 5);
+
+    int color[3], colorStep[3];
+    for (int c = 0; c < 3; c++) {
+        int dc = shaded ? v[1].color[c] - v[0].color[c] : 0;
+        colorStep[c] = steps ? dc * 4096 / steps : 0;
+        color[c] = v[0].color[c] * 4096 + 0x800 + colorStep[c] * first;
     }
 
-    int dx = x1 - x0;
-    int dy = y1 - y0;
-    int derror = std::abs(dy) * 2;
-    int error = 0;
-    int _y = y0;
-    for (int _x = x0; _x <= x1; _x++) {
-        if (steep) {
-            if (gpu->insideDrawingArea(_y, _x)) VRAM[_x][_y] = to15bit(c[0].raw);
-        } else {
-            if (gpu->insideDrawingArea(_x, _y)) VRAM[_y][_x] = to15bit(c[0].raw);
-        }
-        error += derror;
-        if (error > dx) {
-            _y += (y1 > y0 ? 1 : -1);
-            error -= dx * 2;
+    uint16_t maskSet = gpu->gp0_e6.setMaskWhileDrawing ? 0x8000 : 0;
+    bool maskCheck = gpu->gp0_e6.checkMaskBeforeDraw;
+    int scale = gpu->resolutionMultiplier;
+    int vramWidth = gpu->getVramWidth();
+
+    for (int i = first; i < last; i++) {
+        int x = xAt(i);
+        int y = yAt(i);
+
+        RGB rgb = {};
+        rgb.r = color[0] >> 12;
+        rgb.g = color[1] >> 12;
+        rgb.b = color[2] >> 12;
+        for (int c = 0; c < 3; c++) color[c] += colorStep[c];
+        uint16_t pixel = (dithered ? dither(x, y, rgb) : to15bit(rgb.r, rgb.g, rgb.b)) | maskSet;
+
+        for (int sy = 0; sy < scale; sy++) {
+            uint16_t* p = &gpu->vram[(y * scale + sy) * vramWidth + x * scale];
+            for (int sx = 0; sx < scale; sx++) {
+                if (maskCheck && (p[sx] & 0x8000)) continue;
+                p[sx] = semiTransparent ? blend(p[sx], pixel, transparency) | maskSet : pixel;
+            }
         }
     }
 }
@@ -5,18 +5,6 @@
 #include "texture_utils.h"
 #include "utils/macros.h"
 
-#undef VRAM
-#define VRAM ((uint16_t(*)[VRAM_WIDTH])gpu->vram.data())
-
-// clang-format off
-int ditherTable[4][4] = {
-    {-4, +0, -3, +1}, 
-    {+2, -2, +3, -1}, 
-    {-3, +1, -4, +0}, 
-    {+3, -1, +2, -2}
-};
-// clang-format on
-
 int orient2d(const glm::ivec2& a, const glm::ivec2& b, const glm::ivec2& c) {
     return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
 }
@@ -51,18 +39,24 @@ INLINE glm::ivec2 calculateTexel(GPU* gpu, glm::vec3 s, glm::ivec2 tex[3]) {
     return texel;
 }
 
-INLINE PSXColor doShading(glm::vec3 s, glm::ivec2 p, glm::vec3* color, int flags) {
-    glm::vec3 outColor(s.x * color[0].r + s.y * color[1].r + s.z * color[2].r,  //
-                       s.x * color[0].g + s.y * color[1].g + s.z * color[2].g,  //
-                       s.x * color[0].b + s.y * color[1].b + s.z * color[2].b);
+// Colors are in 0-255 range
+INLINE RGB interpolateColor(glm::vec3 s, const glm::vec3* color) {
+    RGB c = {};
+    c.r = (uint8_t)std::min(s.x * color[0].r + s.y * color[1].r + s.z * color[2].r, 255.f);
+    c.g = (uint8_t)std::min(s.x * color[0].g + s.y * color[1].g + s.z * color[2].g, 255.f);
+    c.b = (uint8_t)std::min(s.x * color[0].b + s.y * color[1].b + s.z * color[2].b, 255.f);
+    return c;
+}
+
+INLINE uint16_t doShading(glm::vec3 s, glm::ivec2 p, glm::vec3* color, int flags) {
+    RGB c = interpolateColor(s, color);
 
     // TODO: THPS2 fading screen doesn't look as it should
     if (flags & Vertex::Dithering && !(flags & Vertex::RawTexture)) {
-        outColor += ditherTable[p.y % 4][p.x % 4] / 255.f;
-        outColor = glm::clamp(outColor, 0.f, 1.f);
+        return dither(p.x, p.y, c);
     }
 
-    return to15bit((uint8_t)(255 * outColor.r), (uint8_t)(255 * outColor.g), (uint8_t)(255 * outColor.b));
+    return to15bit(c.r, c.g, c.b);
 }
 
 template <ColorDepth bits>
@@ -82,35 +76,27 @@ INLINE void plotPixel(GPU* gpu, glm::ivec2 p, glm::vec3 s, glm::vec3* color, glm
 
     // If texture blending is enabled
     if (bits != ColorDepth::NONE && !(flags & Vertex::RawTexture)) {
-        glm::vec3 brightness;
+        RGB brightness;
 
         if (flags & Vertex::GouroudShading) {
-            brightness = glm::vec3(s.x * color[0].r + s.y * color[1].r + s.z * color[2].r,  //
-                                   s.x * color[0].g + s.y * color[1].g + s.z * color[2].g,  //
-                                   s.x * color[0].b + s.y * color[1].b + s.z * color[2].b);
+            brightness = interpolateColor(s, color);
         } else {  // Flat shading
-            brightness = glm::vec3(color[0]);
+            brightness.r = (uint8_t)color[0].r;
+            brightness.g = (uint8_t)color[0].g;
+            brightness.b = (uint8_t)color[0].b;
         }
 
-        c = c * (brightness * 2.f);
+        c = modulate(c.raw, brightness);
     }
 
-    // TODO: Mask support
+    uint16_t bg = gpu->vram[p.y * gpu->getVramWidth() + p.x];
+    if (gpu->gp0_e6.checkMaskBeforeDraw && (bg & 0x8000)) return;
 
     if ((flags & Vertex::SemiTransparency) && ((bits != ColorDepth::NONE && c.k) || (bits == ColorDepth::NONE))) {
-        using Transparency = GP0_E1::SemiTransparency;
-
-        PSXColor bg = VRAM[p.y][p.x];
-        Transparency transparency = (Transparency)((flags & 0x60) >> 5);
-        switch (transparency) {
-            case Transparency::Bby2plusFby2: c = bg / 2.f + c / 2.f; break;
-            case Transparency::BplusF: c = bg + c; break;
-            case Transparency::BminusF: c = bg - c; break;
-            case Transparency::BplusFby4: c = bg + c / 4.f; break;
-        }
+        c = blend(bg, c.raw, (GP0_E1::SemiTransparency)((flags & 0x60) >> 5));
     }
 
-    VRAM[p.y][p.x] = c.raw;
+    gpu->vram[p.y * gpu->getVramWidth() + p.x] = c.raw | (gpu->gp0_e6.setMaskWhileDrawing ? 0x8000 : 0);
 }
 
 template <ColorDepth bits>
@@ -174,8 +160,9 @@ void drawTriangle(GPU* gpu, Vertex v[3]) {
     int bits;
     int flags;
     for (int j = 0; j < 3; j++) {
-        pos[j] = glm::ivec2(v[j].position[0], v[j].position[1]);
-        color[j] = glm::vec3(v[j].color[0] / 255.f, v[j].color[1] / 255.f, v[j].color[2] / 255.f);
+        // Rasterized in internal resolution, texture coordinates stay native
+        pos[j] = glm::ivec2(v[j].position[0], v[j].position[1]) * gpu->resolutionMultiplier;
+        color[j] = glm::vec3(v[j].color[0], v[j].color[1], v[j].color[2]);
         texcoord[j] = glm::ivec2(v[j].texcoord[0], v[j].texcoord[1]);
     }
 
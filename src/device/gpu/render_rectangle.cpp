@@ -1,6 +1,113 @@
+#include <algorithm>
+#include "psx_color.h"
 #include "render.h"
+#include "utils/logic.h"
+#include "utils/macros.h"
 
-#undef VRAM
-#define VRAM ((uint16_t(*)[VRAM_WIDTH])gpu->vram.data())
+namespace {
+// Bits above 16-bit color in span buffer
+const uint32_t SPAN_DRAW = 1 << 16;
+const uint32_t SPAN_BLEND = 1 << 17;
+}  // namespace
 
-void drawRectangle(GPU* gpu, const int16_t x[4], const int16_t y[4], const RGB color[4], const TextureInfo tex, bool textured, int flags) {}
\ No newline at end of file
+/**
+ * Sprites are axis aligned and have 1:1 texel step, so instead of rasterizing two triangles
+ * every row is expanded into span buffer (texture fetch, modulation) and then written to VRAM.
+ */
+void drawRectangle(GPU* gpu, int16_t x, int16_t y, int16_t w, int16_t h, RGB color, const TextureInfo& tex, bool textured, int flags) {
+    int left = extend_sign<10>(x) + gpu->drawingOffsetX;
+    int top = extend_sign<10>(y) + gpu->drawingOffsetY;
+
+    // Clip once against drawing area
+    int x0 = std::max<int>({left, gpu->drawingArea.left, 0});
+    int y0 = std::max<int>({top, gpu->drawingArea.top, 0});
+    int x1 = std::min<int>({left + w, gpu->drawingArea.right, VRAM_WIDTH});
+    int y1 = std::min<int>({top + h, gpu->drawingArea.bottom, VRAM_HEIGHT});
+    if (x0 >= x1 || y0 >= y1) return;
+
+    gpu->markVram(x0, y0, x1 - x0, y1 - y0);
+
+    auto transparency = gpu->gp0_e1.semiTransparency;
+    uint16_t maskSet = gpu->gp0_e6.setMaskWhileDrawing ? 0x8000 : 0;
+    bool maskCheck = gpu->gp0_e6.checkMaskBeforeDraw;
+    bool semiTransparent = flags & Vertex::SemiTransparency;
+    bool modulated = textured && !(flags & Vertex::RawTexture);
+
+    int bits = textured ? tex.getBitcount() : 0;
+    glm::ivec2 texPage(tex.getBaseX(), tex.getBaseY());
+    glm::ivec2 clutPos(tex.getClutX(), tex.getClutY());
+
+    // CLUT is fetched once per sprite
+    uint16_t clut[256];
+    if (bits == 4 || bits == 8) {
+        for (int i = 0; i < (bits == 4 ? 16 : 256); i++) {
+            clut[i] = gpu->readVram((clutPos.x + i) & (VRAM_WIDTH - 1), clutPos.y);
+        }
+    }
+
+    const auto& window = gpu->gp0_e2;
+    auto applyWindow = [](int t, int mask, int offset) { return ((t & ~(mask * 8)) | ((offset & mask) * 8)) & 0xff; };
+
+    int stepX = gpu->gp0_e1.texturedRectangleXFlip ? -1 : 1;
+    int stepY = gpu->gp0_e1.texturedRectangleYFlip ? -1 : 1;
+
+    uint32_t solid = to15bit(color.raw) | SPAN_DRAW | (semiTransparent ? SPAN_BLEND : 0);
+
+    int scale = gpu->resolutionMultiplier;
+    int vramWidth = gpu->getVramWidth();
+    uint32_t span[VRAM_WIDTH];
+    int spanLength = x1 - x0;
+
+    for (int py = y0; py < y1; py++) {
+        if (!textured) {
+            std::fill_n(span, spanLength, solid);
+        } else {
+            int v = applyWindow(tex.uv[0].y + (py - top) * stepY, window.textureWindowMaskY, window.textureWindowOffsetY);
+            int u = tex.uv[0].x + (x0 - left) * stepX;
+
+            for (int i = 0; i < spanLength; i++, u += stepX) {
+                int tu = applyWindow(u, window.textureWindowMaskX, window.textureWindowOffsetX);
+
+                uint16_t texel;
+                if (bits == 4) {
+                    uint16_t index = gpu->readVram((texPage.x + tu / 4) & (VRAM_WIDTH - 1), texPage.y + v);
+                    texel = clut[(index >> ((tu & 3) * 4)) & 0xf];
+                } else if (bits == 8) {
+                    uint16_t index = gpu->readVram((texPage.x + tu / 2) & (VRAM_WIDTH - 1), texPage.y + v);
+                    texel = clut[(index >> ((tu & 1) * 8)) & 0xff];
+                } else {
+                    texel = gpu->readVram((texPage.x + tu) & (VRAM_WIDTH - 1), texPage.y + v);
+                }
+
+                // Fully transparent texel
+                if (texel == 0x0000) {
+                    span[i] = 0;
+                    continue;
+                }
+
+                bool blended = semiTransparent && (texel & 0x8000);
+                if (modulated) texel = modulate(texel, color);
+                span[i] = texel | SPAN_DRAW | (blended ? SPAN_BLEND : 0);
+            }
+        }
+
+        for (int sy = 0; sy < scale; sy++) {
+            uint16_t* row = &gpu->vram[(py * scale + sy) * vramWidth + x0 * scale];
+            for (int i = 0; i < spanLength; i++) {
+                uint32_t s = span[i];
+                if (!(s & SPAN_DRAW)) continue;
+
+                uint16_t* p = row + i * scale;
+                if (!(s & SPAN_BLEND) && !maskCheck) {
+                    std::fill_n(p, scale, (uint16_t)(s | maskSet));
+                    continue;
+                }
+                for (int sx = 0; sx < scale; sx++) {
+                    if (maskCheck && (p[sx] & 0x8000)) continue;
+                    uint16_t c = (s & SPAN_BLEND) ? blend(p[sx], s & 0xffff, transparency) : (uint16_t)s;
+                    p[sx] = c | maskSet;
+                }
+            }
+        }
+    }
+}
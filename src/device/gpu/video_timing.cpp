@@ -0,0 +1,78 @@
+#include "video_timing.h"
+#include <algorithm>
+
+namespace {
+// Visible lines used when GP1(07h) holds invalid range (eg. before GPU reset)
+const int DEFAULT_DISPLAY_NTSC[2] = {16, 256};
+const int DEFAULT_DISPLAY_PAL[2] = {19, 307};
+}  // namespace
+
+const int VideoTiming::CYCLES_PER_LINE_NTSC;
+const int VideoTiming::CYCLES_PER_LINE_PAL;
+const int VideoTiming::LINES_NTSC;
+const int VideoTiming::LINES_PAL;
+constexpr double VideoTiming::CLOCK_NTSC;
+constexpr double VideoTiming::CLOCK_PAL;
+
+void VideoTiming::configure(bool pal, bool interlaced, int horizontalResolution, int x1, int x2, int y1, int y2) {
+    this->pal = pal;
+    this->interlaced = interlaced;
+
+    switch (horizontalResolution) {
+        case 256: dotDivisor = 10; break;
+        case 320: dotDivisor = 8; break;
+        case 368: dotDivisor = 7; break;
+        case 512: dotDivisor = 5; break;
+        case 640: dotDivisor = 4; break;
+        default: dotDivisor = 10; break;
+    }
+
+    displayStartX = x1;
+    displayEndX = x2;
+    displayStartY = y1;
+    displayEndY = y2;
+}
+
+int VideoTiming::vblankStartLine() const {
+    int end = displayEndY;
+    if (displayEndY <= displayStartY) end = pal ? DEFAULT_DISPLAY_PAL[1] : DEFAULT_DISPLAY_NTSC[1];
+
+    // Vblank has to happen in every frame
+    return std::min(std::max(end, 1), linesPerFrame() - 1);
+}
+
+int VideoTiming::vblankEndLine() const {
+    int start = displayStartY;
+    if (displayEndY <= displayStartY) start = pal ? DEFAULT_DISPLAY_PAL[0] : DEFAULT_DISPLAY_NTSC[0];
+
+    return std::min(std::max(start, 0), vblankStartLine() - 1);
+}
+
+double VideoTiming::refreshRate() const {
+    double lines = pal ? LINES_PAL : LINES_NTSC;
+    if (interlaced) lines -= 0.5;
+    return (pal ? CLOCK_PAL : CLOCK_NTSC) / (cyclesPerLine() * lines);
+}
+
+bool VideoTiming::step(int cycles) {
+    dotCycle += cycles;
+    dots += dotCycle / dotDivisor;
+    dotCycle %= dotDivisor;
+
+    cycle += cycles;
+    bool vblankStarted = false;
+    while (cycle >= cyclesPerLine()) {
+        cycle -= cyclesPerLine();
+        hblanks++;
+
+        if (++line >= linesPerFrame()) {
+            line = 0;
+            if (interlaced) oddField = !oddField;
+        }
+        if (line == vblankStartLine()) {
+            vblanks++;
+            vblankStarted = true;
+        }
+    }
+    return vblankStarted;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * Video (CRT controller) timing, driven by GPU clock cycles.
+ * Tracks position of the beam for both regions, all horizontal resolutions and interlaced modes.
+ * Events are exposed as free running counters, consumers (timers) keep last seen value and use the difference.
+ */
+struct VideoTiming {
+    static const int CYCLES_PER_LINE_NTSC = 3413;
+    static const int CYCLES_PER_LINE_PAL = 3406;
+    static const int LINES_NTSC = 263;
+    static const int LINES_PAL = 314;
+
+    // GPU clock (Hz)
+    static constexpr double CLOCK_NTSC = 53693175.0;
+    static constexpr double CLOCK_PAL = 53203425.0;
+
+    // Configuration, set from GP1(06h..08h)
+    bool pal = false;
+    bool interlaced = false;
+    int dotDivisor = 10;        // GPU cycles per dot (10, 8, 7, 5, 4 for 256, 320, 368, 512, 640 pixels)
+    int displayStartX = 0x200;  // Cycles in line (GP1(06h))
+    int displayEndX = 0xc00;
+    int displayStartY = 0x10;  // Lines (GP1(07h))
+    int displayEndY = 0x100;
+
+    // Beam position
+    int cycle = 0;
+    int line = 0;
+    bool oddField = false;  // Toggled every frame in interlaced modes
+
+    // Event counters
+    uint32_t dots = 0;
+    uint32_t hblanks = 0;
+    uint32_t vblanks = 0;
+
+    void configure(bool pal, bool interlaced, int horizontalResolution, int x1, int x2, int y1, int y2);
+
+    int cyclesPerLine() const { return pal ? CYCLES_PER_LINE_PAL : CYCLES_PER_LINE_NTSC; }
+
+    // Interlaced frame alternates between 263/262 (NTSC) and 314/313 (PAL) lines
+    int linesPerFrame() const { return (pal ? LINES_PAL : LINES_NTSC) - (interlaced && oddField ? 1 : 0); }
+
+    int vblankStartLine() const;
+    int vblankEndLine() const;
+
+    bool inHblank() const { return cycle < displayStartX || cycle >= displayEndX; }
+    bool inVblank() const { return line >= vblankStartLine() || line < vblankEndLine(); }
+
+    // Frames (fields) per second of real hardware, 59.82/59.93 Hz (NTSC) or 49.75/49.83 Hz (PAL), progressive/interlaced
+    double refreshRate() const;
+
+    // Advances by GPU cycles, returns true if vblank has started
+    bool step(int cycles);
+
+   private:
+    int dotCycle = 0;
+};
@@ -1,5 +1,4 @@
 #pragma once
-#include <deque>
 #include "device.h"
 
 class MDEC {
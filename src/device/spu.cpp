@@ -1,4 +1,5 @@
 #include "spu.h"
+#include <algorithm>
 #include <cstring>
 #include "system.h"
 
@@ -188,6 +189,30 @@ void SPU::write(uint32_t address, uint8_t data) {
     // printf("UNHANDLED SPU WRITE AT 0x%08x: 0x%02x\n", address, data);
 }
 
+void SPU::readDma(uint32_t* data, size_t count) {
+    auto dst = reinterpret_cast<uint8_t*>(data);
+    for (size_t bytes = count * 4; bytes > 0;) {
+        currentDataAddress %= RAM_SIZE;
+        size_t chunk = std::min<size_t>(bytes, RAM_SIZE - currentDataAddress);
+        memcpy(dst, &ram[currentDataAddress], chunk);
+        currentDataAddress += chunk;
+        dst += chunk;
+        bytes -= chunk;
+    }
+}
+
+void SPU::writeDma(const uint32_t* data, size_t count) {
+    auto src = reinterpret_cast<const uint8_t*>(data);
+    for (size_t bytes = count * 4; bytes > 0;) {
+        currentDataAddress %= RAM_SIZE;
+        size_t chunk = std::min<size_t>(bytes, RAM_SIZE - currentDataAddress);
+        memcpy(&ram[currentDataAddress], src, chunk);
+        currentDataAddress += chunk;
+        src += chunk;
+        bytes -= chunk;
+    }
+}
+
 void SPU::dumpRam() {
     std::vector<uint8_t> ram;
     ram.assign(this->ram, this->ram + RAM_SIZE - 1);
@@ -1,6 +1,6 @@
 #pragma once
+#include <cstddef>
 #include "device.h"
-#include <deque>
 
 class SPU {
     struct Voice {
@@ -57,5 +57,9 @@ class SPU {
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
 
+    // DMA4, data goes through transfer address the same way as Data FIFO writes
+    void readDma(uint32_t* data, size_t count);
+    void writeDma(const uint32_t* data, size_t count);
+
     void dumpRam();
 };
\ No newline at end of file
@@ -1,4 +1,6 @@
 #include "timer.h"
+#include <algorithm>
+#include <limits>
 #include "system.h"
 
 using namespace timer;
@@ -7,67 +9,175 @@ template <int which>
 Timer<which>::Timer(System* sys) : sys(sys) {}
 
 template <int which>
-void Timer<which>::step(int cycles) {
-    cnt += cycles;
-
-    if (which == 0) {
-        if (mode.clockSource0 == CounterMode::ClockSource0::dotClock) {
-            current._reg += cnt / 6;
-            cnt %= 6;
-        } else {  // System Clock
-            current._reg += cnt / 3;
-            cnt %= 3;
+bool Timer<which>::dependsOnVideo() const {
+    if (which == 0 && mode.clockSource0() == CounterMode::ClockSource0::dotClock) return true;
+    if (which == 1 && mode.clockSource1() == CounterMode::ClockSource1::hblank) return true;
+    return which != 2 && mode.synchronizationEnable == CounterMode::SynchronizationEnable::synchronize;
+}
+
+template <int which>
+bool Timer<which>::stopped() const {
+    if (which != 2 || mode.synchronizationEnable != CounterMode::SynchronizationEnable::synchronize) return false;
+
+    auto sync = static_cast<CounterMode::SynchronizationMode2>(mode.synchronizationMode);
+    return sync == CounterMode::SynchronizationMode2::stopCounterAtCurrentValue
+           || sync == CounterMode::SynchronizationMode2::stopCounterAtCurrentValue_;
+}
+
+template <int which>
+int Timer<which>::divisor() const {
+    return (which == 2 && mode.clockSource2 == CounterMode::ClockSource2::systemClock_8) ? 8 * 3 : 3;
+}
+
+template <int which>
+void Timer<which>::update() {
+    const VideoTiming& timing = sys->gpu->timing;
+    uint32_t dots = timing.dots - lastDots;
+    uint32_t hblanks = timing.hblanks - lastHblanks;
+    uint32_t vblanks = timing.vblanks - lastVblanks;
+    lastDots = timing.dots;
+    lastHblanks = timing.hblanks;
+    lastVblanks = timing.vblanks;
+
+    uint64_t cycles = sys->cycles - lastCycle;
+    lastCycle = sys->cycles;
+
+    uint64_t ticks;
+    if (which == 0 && mode.clockSource0() == CounterMode::ClockSource0::dotClock) {
+        ticks = dots;
+    } else if (which == 1 && mode.clockSource1() == CounterMode::ClockSource1::hblank) {
+        ticks = hblanks;
+    } else {
+        cycles += cnt;
+        ticks = cycles / divisor();
+        cnt = cycles % divisor();
+    }
+
+    if (stopped()) ticks = 0;
+
+    if (which != 2 && mode.synchronizationEnable == CounterMode::SynchronizationEnable::synchronize) {
+        // Timer 0 is synchronized to hblank, timer 1 to vblank (modes share values)
+        uint32_t blanks = which == 0 ? hblanks : vblanks;
+        bool inBlank = which == 0 ? timing.inHblank() : timing.inVblank();
+
+        switch (static_cast<CounterMode::SynchronizationMode0>(mode.synchronizationMode)) {
+            case CounterMode::SynchronizationMode0::pauseCounterDuringHblanks:
+                if (inBlank) ticks = 0;
+                break;
+            case CounterMode::SynchronizationMode0::resetCounterAtHblanks:
+                if (blanks) current._reg = 0;
+                break;
+            case CounterMode::SynchronizationMode0::resetCounterAtHblanksAndPauseOutside:
+                if (blanks) current._reg = 0;
+                if (!inBlank) ticks = 0;
+                break;
+            case CounterMode::SynchronizationMode0::pauseUntilHblanksOnceAndFreerun:
+                if (blanks) {
+                    mode.synchronizationEnable = CounterMode::SynchronizationEnable::freeRun;
+                } else {
+                    ticks = 0;
+                }
+                break;
         }
-    } else if (which == 1) {
-        if (mode.clockSource1 == CounterMode::ClockSource1::hblank) {
-            current._reg += cnt / 3413;
-            cnt %= 3413;
-        } else {  // System Clock
-            current._reg += cnt / 3;
-            cnt %= 3;
+    }
+
+    advance(ticks);
+}
+
+template <int which>
+void Timer<which>::advance(uint64_t ticks) {
+    // Counter resets to 0 when it reaches target (if enabled) or 0xffff
+    uint32_t target = this->target._reg;
+    bool resetAtTarget = mode.resetToZero == CounterMode::ResetToZero::whenTarget && target != 0;
+    uint32_t counter = current._reg & 0xffff;
+    bool reachedTarget = false;
+    bool reachedFFFF = false;
+
+    while (ticks > 0) {
+        uint32_t wrap = (resetAtTarget && counter < target) ? target : 0xffff;
+
+        // Whole periods at once, target is passed in each of them
+        if (counter == 0 && ticks >= wrap) {
+            ticks %= wrap;
+            reachedTarget = true;
+            reachedFFFF |= wrap == 0xffff;
+            continue;
         }
-    } else if (which == 2) {
-        if (mode.clockSource2 == CounterMode::ClockSource2::systemClock_8) {
-            current._reg += cnt / (8 * 3);
-            cnt %= 8 * 3;
-        } else {  // System Clock
-            current._reg += cnt / 3;
-            cnt %= 3;
+
+        uint32_t n = (uint32_t)std::min<uint64_t>(ticks, wrap - counter);
+        if (counter < target && counter + n >= target) reachedTarget = true;
+        counter += n;
+        ticks -= n;
+
+        if (counter == wrap) {
+            counter = 0;
+            if (wrap == 0xffff) reachedFFFF = true;
+            if (target == 0) reachedTarget = true;
         }
     }
+    current._reg = counter;
 
-    if (current._reg >= target._reg) {
-        mode.reachedTarget = true;
-        if (mode.resetToZero == CounterMode::ResetToZero::whenTarget && target._reg != 0) current._reg = 0;  // TODO: HAX?
-    }
+    if (reachedTarget) mode.reachedTarget = true;
+    if (reachedFFFF) mode.reachedFFFF = true;
+    if ((reachedTarget && mode.irqWhenTarget) || (reachedFFFF && mode.irqWhenFFFF)) irq();
+}
+
+template <int which>
+void Timer<which>::irq() {
+    if (mode.irqRepeatMode == CounterMode::IrqRepeatMode::oneShot && irqOccured) return;
+    irqOccured = true;
 
-    if (current._reg >= 0xffff) {
-        mode.reachedFFFF = true;
-        if (mode.resetToZero == CounterMode::ResetToZero::whenFFFF) current._reg = 0;
+    // Bit 10 is active low and IRQ is raised on its falling edge, short pulse goes back to 1 before CPU could see it
+    if (mode.irqPulseMode == CounterMode::IrqPulseMode::toggle) {
+        mode.interruptRequest = !mode.interruptRequest;
+        if (mode.interruptRequest) return;
     }
+    sys->interrupt->trigger(mapIrqNumber());
+}
 
-    if (mode.irqWhenTarget || mode.irqWhenFFFF) {
-        if (mode.irqRepeatMode == CounterMode::IrqRepeatMode::repeatedly
-            || (mode.irqRepeatMode == CounterMode::IrqRepeatMode::oneShot && !irqOccured)) {
-            if (mode.irqPulseMode == CounterMode::IrqPulseMode::toggle)
-                mode.interruptRequest = !mode.interruptRequest;
-            else
-                mode.interruptRequest = false;
-        }
+template <int which>
+void Timer<which>::schedule() {
+    // Video clocked counters are stepped in every slice like GPU itself
+    if (dependsOnVideo()) {
+        deadline = lastCycle;
+        return;
     }
 
-    if (mode.interruptRequest == false && !irqOccured) {
-        sys->interrupt->trigger(mapIrqNumber());
-        irqOccured = true;
+    deadline = std::numeric_limits<uint64_t>::max();
+    if (stopped()) return;
+    if (mode.irqRepeatMode == CounterMode::IrqRepeatMode::oneShot && irqOccured) return;
+
+    uint32_t target = this->target._reg;
+    bool resetAtTarget = mode.resetToZero == CounterMode::ResetToZero::whenTarget && target != 0;
+    uint32_t counter = current._reg & 0xffff;
+
+    // Ticks until next event that raises IRQ
+    uint32_t ticks = std::numeric_limits<uint32_t>::max();
+    if (mode.irqWhenTarget) {
+        ticks = counter < target ? target - counter : 0xffff - counter + target;
     }
+    if (mode.irqWhenFFFF && !(resetAtTarget && counter < target)) {
+        ticks = std::min<uint32_t>(ticks, 0xffff - counter);
+    }
+    if (ticks == std::numeric_limits<uint32_t>::max()) return;
+
+    deadline = lastCycle + (uint64_t)std::max<uint32_t>(ticks, 1) * divisor() - cnt;
+}
+
+template <int which>
+void Timer<which>::step() {
+    update();
+    schedule();
 }
 
 template <int which>
 uint8_t Timer<which>::read(uint32_t address) {
     if (address < 2) {
+        step();
         return current.read(address);
     }
     if (address >= 4 && address < 8) {
+        step();
         uint8_t v = mode.read(address - 4);
         if (address == 7) {
             mode.reachedFFFF = false;
@@ -83,17 +193,25 @@ uint8_t Timer<which>::read(uint32_t address) {
 
 template <int which>
 void Timer<which>::write(uint32_t address, uint8_t data) {
+    // Counter runs with old settings until the write
+    update();
+
     if (address < 2) {
         current.write(address, data);
     } else if (address >= 4 && address < 8) {
         current._reg = 0;
+        cnt = 0;
         irqOccured = false;
+        if (address == 5) data = (data & ~0x1c) | (mode._byte[1] & 0x1c);  // IRQ and reached flags are read only
         mode.write(address - 4, data);  // BIOS uses 0x0148 for TIMER1
+        mode.interruptRequest = true;   // No IRQ until next event
     } else if (address >= 8 && address < 12) {
         target.write(address - 8, data);
     }
+
+    schedule();
 }
 
 template class Timer<0>;
 template class Timer<1>;
-template class Timer<2>;
\ No newline at end of file
+template class Timer<2>;
@@ -1,11 +1,12 @@
 #pragma once
 #include <cassert>
+#include <cstdint>
 #include "device.h"
 #include "interrupt.h"
 
 namespace timer {
 union CounterMode {
-    enum class SynchronizationEnable { freeRun = 0, synchronize = 1 };
+    enum class SynchronizationEnable : uint32_t { freeRun = 0, synchronize = 1 };
     enum class SynchronizationMode0 {
         pauseCounterDuringHblanks = 0,
         resetCounterAtHblanks = 1,
@@ -21,8 +22,8 @@ union CounterMode {
     enum class SynchronizationMode2 {
         stopCounterAtCurrentValue = 0,  // Stop counter at current value (no h/v-blank start)
         freeRun = 1,
-        stopCounterAtCurrentValue_ = 2,
-        freeRun_ = 3
+        freeRun_ = 2,
+        stopCounterAtCurrentValue_ = 3
     };
 
     enum class ResetToZero : uint32_t { whenFFFF = 0, whenTarget = 1 };
@@ -35,13 +36,10 @@ union CounterMode {
     enum class ClockSource1 : uint32_t { systemClock = 0, hblank = 1 };
     enum class ClockSource2 : uint32_t { systemClock = 0, systemClock_8 = 1 };
 
+    // Nested unions can't be used for fields shared between timers, they would break the layout
     struct {
         SynchronizationEnable synchronizationEnable : 1;
-        union {
-            SynchronizationMode0 synchronizationMode0 : 2;
-            SynchronizationMode1 synchronizationMode1 : 2;
-            SynchronizationMode2 synchronizationMode2 : 2;
-        } synchronizationMode;
+        uint32_t synchronizationMode : 2;  // SynchronizationMode0/1/2 for timer 0/1/2
 
         ResetToZero resetToZero : 1;
         uint32_t irqWhenTarget : 1;
@@ -50,10 +48,7 @@ union CounterMode {
         IrqPulseMode irqPulseMode : 1;
 
         // For all timer different clock sources are available
-        union {
-            ClockSource0 clockSource0 : 1;
-            ClockSource1 clockSource1 : 1;
-        };
+        uint32_t clockSource : 1;  // ClockSource0/1 for timer 0/1
         ClockSource2 clockSource2 : 1;
 
         Bit interruptRequest : 1;  // R
@@ -68,6 +63,10 @@ union CounterMode {
     uint8_t _byte[4];
 
     CounterMode() : _reg(0) {}
+
+    ClockSource0 clockSource0() const { return static_cast<ClockSource0>(clockSource); }
+    ClockSource1 clockSource1() const { return static_cast<ClockSource1>(clockSource); }
+
     void write(int n, uint8_t v) {
         if (n >= 4) return;
         _byte[n] = v;
@@ -79,6 +78,8 @@ union CounterMode {
 };
 }  // namespace timer
 
+static_assert(sizeof(timer::CounterMode) == 4, "Counter mode must map to 32 bit register");
+
 template <int which>
 class Timer {
     const int baseAddress = 0x1f801100;
@@ -89,9 +90,18 @@ class Timer {
     Reg16 target;
 
    private:
-    int cnt = 0;
+    int cnt = 0;  // System cycles not yet converted to ticks
     bool irqOccured = false;
 
+    // System cycle counter value at last update and at next target/FFFF event which raises IRQ
+    uint64_t lastCycle = 0;
+    uint64_t deadline = 0;
+
+    // Video timing counters seen in last step
+    uint32_t lastDots = 0;
+    uint32_t lastHblanks = 0;
+    uint32_t lastVblanks = 0;
+
     System* sys;
 
     interrupt::IrqNumber mapIrqNumber() const {
@@ -102,10 +112,25 @@ class Timer {
         return interrupt::TIMER0;
     }
 
+    // Counter driven by dot clock, hblanks or synchronized to blanking, its events can't be predicted from cycles
+    bool dependsOnVideo() const;
+    bool stopped() const;
+    int divisor() const;
+
+    void update();
+    void advance(uint64_t ticks);
+    void irq();
+    void schedule();
+
    public:
     Timer(System* sys);
-    void step() { step(1); }
-    void step(int cycles);
+
+    // Catches up with system cycle counter, raises pending IRQ and predicts next one
+    void step();
+
+    // step() has to be called when system cycle counter reaches this value
+    uint64_t nextEvent() const { return deadline; }
+
     uint8_t read(uint32_t address);
     void write(uint32_t address, uint8_t data);
 };
\ No newline at end of file
@@ -1,5 +1,4 @@
 #include <imgui.h>
-#include <nlohmann/json.hpp>
 #include <vector>
 #include "../../../cpu/gte/gte.h"
 #include "debugger/debugger.h"
@@ -45,16 +44,17 @@ const char *mapIo(uint32_t address) {
 }
 
 void replayCommands(GPU *gpu, int to) {
-    auto commands = gpu->gpuLogList;
-    gpu->vram = gpu->prevVram;
+    const auto &commands = gpu->gpuLog;
+    if (!gpu->restoreFrameStart()) return;
 
+    bool logEnabled = gpu->gpuLogEnabled;
     gpu->gpuLogEnabled = false;
     for (int i = 0; i <= to; i++) {
-        auto cmd = commands.at(i);
+        auto cmd = commands[i];
 
-        if (cmd.args.size() == 0) printf("Panic! no args");
+        if (cmd.argCount == 0) printf("Panic! no args");
 
-        for (size_t j = 0; j < cmd.args.size(); j++) {
+        for (size_t j = 0; j < cmd.argCount; j++) {
             uint32_t arg = cmd.args[j];
 
             if (j == 0) arg |= cmd.command << 24;
@@ -67,7 +67,7 @@ void replayCommands(GPU *gpu, int to) {
             gpu->write(0, arg);
         }
     }
-    gpu->gpuLogEnabled = true;
+    gpu->gpuLogEnabled = logEnabled;
 }
 
 void dumpRegister(const char *name, uint32_t *reg) {
@@ -181,8 +181,9 @@ void gteLogWindow(System *sys) {
     ImGui::BeginChild("GTE Log", ImVec2(0, -ImGui::GetItemsLineHeightWithSpacing()), false, ImGuiWindowFlags_HorizontalScrollbar);
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
 
-    for (size_t i = 0; i < sys->cpu->gte.log.size(); i++) {
-        auto ioEntry = sys->cpu->gte.log.at(i);
+    auto log = sys->cpu->gte.log.snapshot();
+    for (size_t i = 0; i < log.size(); i++) {
+        auto ioEntry = log[i];
         std::string t;
         if (ioEntry.mode == GTE::GTE_ENTRY::MODE::func) {
             t = string_format("%5d %c 0x%02x", i, 'F', ioEntry.n);
@@ -221,10 +222,11 @@ void gpuLogWindow(System *sys) {
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
 
     int renderTo = -1;
-    ImGuiListClipper clipper(sys->gpu.get()->gpuLogList.size());
+
+    ImGuiListClipper clipper(sys->gpu->gpuLog.size());
     while (clipper.Step()) {
         for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
-            auto &entry = sys->gpu.get()->gpuLogList[i];
+            auto entry = sys->gpu->gpuLog[i];
 
             bool nodeOpen = ImGui::TreeNode((void *)(intptr_t)i, "cmd: 0x%02x  %s", entry.command, CommandStr[(int)entry.cmd]);
 
@@ -234,7 +236,7 @@ void gpuLogWindow(System *sys) {
 
             if (nodeOpen) {
                 // Render arguments
-                for (auto &arg : entry.args) {
+                for (auto arg : entry) {
                     ImGui::Text("- 0x%08x", arg);
                 }
                 ImGui::TreePop();
@@ -247,6 +249,10 @@ void gpuLogWindow(System *sys) {
     if (ImGui::Button("Dump")) {
         ImGui::OpenPopup("Save dump dialog");
     }
+    if (sys->gpu->gpuLog.isOverflown()) {
+        ImGui::SameLine();
+        ImGui::TextColored(ImVec4(1.f, 0.3f, 0.3f, 1.f), "Log is full, rest of the frame is missing");
+    }
 
     if (ImGui::BeginPopupModal("Save dump dialog", nullptr, ImGuiWindowFlags_AlwaysAutoResize)) {
         char filename[32];
@@ -255,22 +261,13 @@ void gpuLogWindow(System *sys) {
 
         ImGui::PushItemWidth(140);
         if (ImGui::InputText("", filename, 31, ImGuiInputTextFlags_EnterReturnsTrue)) {
-            auto gpu = sys->gpu.get();
-            auto gpuLog = gpu->gpuLogList;
-            nlohmann::json j;
-
-            for (size_t i = 0; i < gpuLog.size(); i++) {
-                auto e = gpuLog[i];
-                j.push_back({{"command", e.command}, {"cmd", (int)e.cmd}, {"name", CommandStr[(int)e.cmd]}, {"args", e.args}});
+            std::string path = string_format("%s.gpulog", filename);
+            if (sys->gpu->saveLogCapture(path)) {
+                printf("GPU log saved to %s\n", path.c_str());
+            } else {
+                printf("Unable to save GPU log to %s\n", path.c_str());
             }
 
-            putFileContents(string_format("%s.json", filename), j.dump(2));
-
-            // Binary vram dump
-            std::vector<uint8_t> vram;
-            vram.assign(gpu->vram.data(), gpu->vram.data() + (VRAM_WIDTH * VRAM_HEIGHT));
-            putFileContents(string_format("%s.bin", filename), vram);
-
             ImGui::CloseCurrentPopup();
         }
         ImGui::PopItemWidth();
@@ -320,6 +317,19 @@ void ioWindow(System *sys) {
     dumpRegister("target", (uint32_t *)&sys->timer2->target);
     dumpRegister("mode", (uint32_t *)&sys->timer2->mode);
 
+    ImGui::Columns(1, nullptr, false);
+    ImGui::Text("DMA (transfers, last, total bytes)");
+
+    ImGui::Columns(2, nullptr, false);
+    for (int i = 0; i < 7; i++) {
+        auto &channel = sys->dma->dma[i];
+        ImGui::BulletText("DMA%d", i);
+        ImGui::NextColumn();
+        ImGui::Text("%llu, %llu, %llu", (unsigned long long)channel->transfers, (unsigned long long)channel->lastTransferBytes,
+                    (unsigned long long)channel->bytesTransferred);
+        ImGui::NextColumn();
+    }
+
     ImGui::End();
 }
 
@@ -333,10 +343,11 @@ void ioLogWindow(System *sys) {
     ImGui::BeginChild("IO Log", ImVec2(0, -ImGui::GetItemsLineHeightWithSpacing()), false, ImGuiWindowFlags_HorizontalScrollbar);
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
 
-    ImGuiListClipper clipper(sys->ioLogList.size());
+    auto log = sys->ioLog.snapshot();
+    ImGuiListClipper clipper(log.size());
     while (clipper.Step()) {
         for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++) {
-            auto ioEntry = sys->ioLogList.at(i);
+            auto ioEntry = log[i];
             char mode = ioEntry.mode == System::IO_LOG_ENTRY::MODE::READ ? 'R' : 'W';
             ImGui::Text("%c %2d 0x%08x: 0x%0*x %*s %s                  (pc: 0x%08x)", mode, ioEntry.size, ioEntry.addr, ioEntry.size / 4,
                         ioEntry.data,
@@ -120,6 +120,14 @@ void renderImgui(System* sys) {
         // File
 
         // Debug
+        // Logs are collected only while their windows are open
+        sys->cpu->gte.log.enable(gteLogEnabled ? 0xffffffff : 0);
+#ifdef ENABLE_IO_LOG
+        sys->ioLog.enable(ioLogEnabled ? 0xffffffff : 0);
+#endif
+        // Replay in GPU log restores VRAM backed up at the beginning of the frame
+        sys->gpu->gpuLogEnabled = gpuLogEnabled;
+        sys->gpu->backupVram = gpuLogEnabled;
         if (gteRegistersEnabled) gteRegistersWindow(sys->cpu->gte);
         if (ioLogEnabled) ioLogWindow(sys);
         if (gteLogEnabled) gteLogWindow(sys);
@@ -17,13 +17,30 @@ bool showControllerSetupWindow = false;
 void graphicsOptionsWindow() {
     bool filtering = config["options"]["graphics"]["filtering"];
     bool widescreen = config["options"]["graphics"]["widescreen"];
+    bool hardwareRendering = config["options"]["graphics"]["hardwareRendering"];
+    int resolutionMultiplier = config["options"]["graphics"]["resolutionMultiplier"];
+    bool frameSkip = config["options"]["graphics"]["frameSkip"];
     ImGui::Begin("Graphics", &showGraphicsOptionsWindow, ImGuiWindowFlags_AlwaysAutoResize);
 
     if (ImGui::Checkbox("Filtering", &filtering)) {
         config["options"]["graphics"]["filtering"] = filtering;
+        configRevision++;
     }
     if (ImGui::Checkbox("Widescreen (16/9)", &widescreen)) {
         config["options"]["graphics"]["widescreen"] = widescreen;
+        configRevision++;
+    }
+    if (ImGui::Checkbox("Hardware rendering (OpenGL)", &hardwareRendering)) {
+        config["options"]["graphics"]["hardwareRendering"] = hardwareRendering;
+        configRevision++;
+    }
+    if (ImGui::SliderInt("Internal resolution", &resolutionMultiplier, 1, MAX_RESOLUTION_MULTIPLIER)) {
+        config["options"]["graphics"]["resolutionMultiplier"] = resolutionMultiplier;
+        configRevision++;
+    }
+    if (ImGui::Checkbox("Frame skip", &frameSkip)) {
+        config["options"]["graphics"]["frameSkip"] = frameSkip;
+        configRevision++;
     }
 
     ImGui::End();
@@ -22,6 +22,9 @@
 const int CPU_CLOCK = 33868500;
 const int GPU_CLOCK_NTSC = 53690000;
 
+// Auto frameskip still shows at least every n-th frame
+const int MAX_SKIPPED_FRAMES = 3;
+
 device::controller::DigitalController& getButtonState(SDL_Event& event) {
     static SDL_GameController* controller = nullptr;
     static device::controller::DigitalController buttons;
@@ -148,26 +151,9 @@ void loadFile(std::unique_ptr<System>& sys, std::string path) {
         return;
     }
 
-    if (ext == "json") {
-        auto file = getFileContents(path);
-        if (file.empty()) {
-            return;
-        }
-        nlohmann::json j = json::parse(file.begin(), file.end());
-
-        auto& gpuLog = sys->gpu->gpuLogList;
-        gpuLog.clear();
-        for (size_t i = 0; i < j.size(); i++) {
-            GPU::GPU_LOG_ENTRY e;
-            e.command = j[i]["command"];
-            e.cmd = (Command)(int)j[i]["cmd"];
-
-            for (uint32_t a : j[i]["args"]) {
-                e.args.push_back(a);
-            }
-
-            gpuLog.push_back(e);
-        }
+    if (ext == "gpulog") {
+        sys->gpu->loadLogCapture(path);
+        gpuLogEnabled = true;  // Capture is inspected in GPU log window
         return;
     }
 
@@ -215,7 +201,8 @@ void hardReset() {
 }
 
 // Warning: this method might have 1 or more miliseconds of inaccuracy.
-void limitFramerate(SDL_Window* window, bool framelimiter, bool ntsc) {
+// Returns true if emulation is more than one frame behind real time.
+bool limitFramerate(SDL_Window* window, bool framelimiter, double refreshRate, const char* mode) {
     static double timeToSkip = 0;
     static double counterFrequency = SDL_GetPerformanceFrequency();
     static double startTime = SDL_GetPerformanceCounter() / counterFrequency;
@@ -226,7 +213,7 @@ void limitFramerate(SDL_Window* window, bool framelimiter, bool ntsc) {
     double currentTime = SDL_GetPerformanceCounter() / counterFrequency;
     double deltaTime = currentTime - startTime;
 
-    double frameTime = ntsc ? (1.0 / 60.0) : (1.0 / 50.0);
+    double frameTime = 1.0 / refreshRate;
 
     if (framelimiter) {
         // If frame was shorter than frameTime - spin
@@ -261,9 +248,11 @@ void limitFramerate(SDL_Window* window, bool framelimiter, bool ntsc) {
             gameName = getFilename(sys->cdrom->cue.file);
 
         std::string title = string_format("Avocado %s | %s | FPS: %.0f (%0.2f ms) %s", BUILD_STRING, gameName.c_str(), fps,
-                                          (1.0 / fps) * 1000.0, !framelimiter ? "unlimited" : "");
+                                          (1.0 / fps) * 1000.0, mode);
         SDL_SetWindowTitle(window, title.c_str());
     }
+
+    return framelimiter && timeToSkip > frameTime;
 }
 
 int main(int argc, char** argv) {
@@ -311,15 +300,23 @@ int main(int argc, char** argv) {
 
     SDL_GL_SetSwapInterval(0);
 
-    vramTextureId = opengl.getVramTextureId();
     if (!isEmulatorConfigured())
         sys->state = System::State::stop;
     else
         sys->state = System::State::run;
 
     bool frameLimitEnabled = true;
+    bool fastForward = false;
     bool windowFocused = true;
 
+    // Picture shown after emulating a frame is the one drawn during previous frame,
+    // so decision to skip rasterization of a frame is also decision to not present the next one
+    bool renderFrame = true;
+    bool previousFrameRendered = true;
+    bool behind = false;
+    int skippedFrames = 0;
+    uint64_t lastPresentTime = SDL_GetPerformanceCounter();
+
     SDL_Event event;
     while (running && !exitProgram) {
         bool newEvent = false;
@@ -373,7 +370,9 @@ int main(int argc, char** argv) {
                     showVRAM = !showVRAM;
                 }
                 if (event.key.keysym.sym == SDLK_TAB) frameLimitEnabled = !frameLimitEnabled;
+                if (event.key.keysym.sym == SDLK_BACKQUOTE) fastForward = true;
             }
+            if (event.type == SDL_KEYUP && event.key.keysym.sym == SDLK_BACKQUOTE) fastForward = false;
             if (event.type == SDL_DROPFILE) {
                 std::string path = event.drop.file;
                 SDL_free(event.drop.file);
@@ -400,21 +399,54 @@ int main(int argc, char** argv) {
             hardReset();
         }
 
+        bool present = true;
         if (sys->state == System::State::run) {
+            double frameTime = 1.0 / sys->gpu->timing.refreshRate();
+            double sinceLastPresent = (double)(SDL_GetPerformanceCounter() - lastPresentTime) / SDL_GetPerformanceFrequency();
+
+            if (showGui || showVRAM || singleFrame) {
+                renderFrame = true;
+            } else if (fastForward) {
+                // Emulate at full speed, but draw only as many frames as would be shown in real time
+                renderFrame = sinceLastPresent >= frameTime;
+            } else if (opengl.isFrameSkipEnabled()) {
+                renderFrame = !behind || skippedFrames >= MAX_SKIPPED_FRAMES;
+            } else {
+                renderFrame = true;
+            }
+            skippedFrames = renderFrame ? 0 : skippedFrames + 1;
+
+            sys->gpu->skipRendering = !renderFrame;
             sys->emulateFrame();
+            present = previousFrameRendered;
+            previousFrameRendered = renderFrame;
+
             if (singleFrame) {
                 singleFrame = false;
                 sys->state = System::State::pause;
             }
         }
-        ImGui_ImplSdlGL3_NewFrame(window);
 
-        opengl.render(sys->gpu.get());
-        renderImgui(sys.get());
+        if (present) {
+            // Primitives queued in skipped frames are drawn only if they end up visible
+            if (showGui || showVRAM) {
+                sys->gpu->flushDeferred();
+            } else {
+                sys->gpu->flushDeferredDisplay();
+            }
+
+            ImGui_ImplSdlGL3_NewFrame(window);
 
-        SDL_GL_SwapWindow(window);
+            opengl.render(sys->gpu.get());
+            vramTextureId = opengl.getVramTextureId();
+            renderImgui(sys.get());
+
+            SDL_GL_SwapWindow(window);
+            lastPresentTime = SDL_GetPerformanceCounter();
+        }
 
-        limitFramerate(window, frameLimitEnabled, sys->gpu->isNtsc());
+        const char* mode = fastForward ? "fast forward" : (!frameLimitEnabled ? "unlimited" : "");
+        behind = limitFramerate(window, frameLimitEnabled && !fastForward, sys->gpu->timing.refreshRate(), mode);
     }
     saveConfigFile(CONFIG_NAME);
 
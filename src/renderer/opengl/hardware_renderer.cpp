@@ -0,0 +1,287 @@
+#include "hardware_renderer.h"
+#include <algorithm>
+#include <cstddef>
+
+HardwareRenderer::~HardwareRenderer() {
+    if (vbo != 0) glDeleteBuffers(1, &vbo);
+    if (vao != 0) glDeleteVertexArrays(1, &vao);
+    if (vramFbo != 0) glDeleteFramebuffers(1, &vramFbo);
+    if (readFbo != 0) glDeleteFramebuffers(1, &readFbo);
+    if (vramTex != 0) glDeleteTextures(1, &vramTex);
+    if (readTex != 0) glDeleteTextures(1, &readTex);
+}
+
+bool HardwareRenderer::setup() {
+    renderShader = std::make_unique<Program>("data/shader/render");
+    if (!renderShader->load()) {
+        printf("Cannot load render shader: %s\n", renderShader->getError().c_str());
+        return false;
+    }
+
+    createVramTextures();
+    createVertexBuffer();
+
+    buffer.reserve(MAX_VERTICES);
+    return true;
+}
+
+void HardwareRenderer::createVramTextures() {
+    auto create = [](GLuint& tex, GLuint& fbo) {
+        glGenTextures(1, &tex);
+        glBindTexture(GL_TEXTURE_2D, tex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB5_A1, VRAM_WIDTH, VRAM_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, nullptr);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            printf("HardwareRenderer: VRAM framebuffer is incomplete\n");
+        }
+    };
+
+    create(vramTex, vramFbo);
+    create(readTex, readFbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void HardwareRenderer::createVertexBuffer() {
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, MAX_VERTICES * sizeof(Vertex), nullptr, GL_STREAM_DRAW);
+
+    renderShader->getAttrib("position").pointer(2, GL_INT, sizeof(Vertex), offsetof(Vertex, position));
+    renderShader->getAttrib("color").pointer(3, GL_INT, sizeof(Vertex), offsetof(Vertex, color));
+    renderShader->getAttrib("texcoord").pointer(2, GL_INT, sizeof(Vertex), offsetof(Vertex, texcoord));
+    renderShader->getAttrib("bitcount").pointer(1, GL_INT, sizeof(Vertex), offsetof(Vertex, bitcount));
+    renderShader->getAttrib("clut").pointer(2, GL_INT, sizeof(Vertex), offsetof(Vertex, clut));
+    renderShader->getAttrib("texpage").pointer(2, GL_INT, sizeof(Vertex), offsetof(Vertex, texpage));
+    renderShader->getAttrib("flags").pointer(1, GL_INT, sizeof(Vertex), offsetof(Vertex, flags));
+    renderShader->getAttrib("textureWindow").pointer(4, GL_INT, sizeof(Vertex), offsetof(Vertex, textureWindow));
+
+    glBindVertexArray(0);
+}
+
+void HardwareRenderer::attach(GPU* gpu) {
+    this->gpu = gpu;
+    buffer.clear();
+    drawingArea = gpu->drawingArea;
+    blendMode = NO_BLENDING;
+
+    gpu->flushDeferred();
+    uploadVram(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+    gpu->backend = this;
+}
+
+void HardwareRenderer::detach() {
+    if (gpu == nullptr) return;
+
+    readVram(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+    gpu->dirtyTiles.set();
+    gpu->backend = nullptr;
+    gpu = nullptr;
+}
+
+void HardwareRenderer::setupState() {
+    glBindFramebuffer(GL_FRAMEBUFFER, vramFbo);
+    glViewport(0, 0, VRAM_WIDTH, VRAM_HEIGHT);
+
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(drawingArea.left, drawingArea.top, std::max(0, drawingArea.right - drawingArea.left),
+              std::max(0, drawingArea.bottom - drawingArea.top));
+}
+
+void HardwareRenderer::updateReadTexture() {
+    if (!readTexDirty) return;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, vramFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, readFbo);
+    glDisable(GL_SCISSOR_TEST);
+    glBlitFramebuffer(0, 0, VRAM_WIDTH, VRAM_HEIGHT, 0, 0, VRAM_WIDTH, VRAM_HEIGHT, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    readTexDirty = false;
+}
+
+void HardwareRenderer::setBlending(int mode) {
+    using Transparency = GP0_E1::SemiTransparency;
+
+    if (mode == NO_BLENDING) {
+        glDisable(GL_BLEND);
+        return;
+    }
+
+    // Mask bit (alpha) is never blended
+    glEnable(GL_BLEND);
+    switch ((Transparency)mode) {
+        case Transparency::Bby2plusFby2:
+            glBlendColor(0.5f, 0.5f, 0.5f, 0.5f);
+            glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+            glBlendFuncSeparate(GL_CONSTANT_COLOR, GL_CONSTANT_COLOR, GL_ONE, GL_ZERO);
+            break;
+        case Transparency::BplusF:
+            glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+            glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ZERO);
+            break;
+        case Transparency::BminusF:
+            glBlendEquationSeparate(GL_FUNC_REVERSE_SUBTRACT, GL_FUNC_ADD);
+            glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ONE, GL_ZERO);
+            break;
+        case Transparency::BplusFby4:
+            glBlendColor(0.25f, 0.25f, 0.25f, 0.25f);
+            glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+            glBlendFuncSeparate(GL_CONSTANT_COLOR, GL_ONE, GL_ONE, GL_ZERO);
+            break;
+    }
+}
+
+void HardwareRenderer::drawPass(Pass pass) {
+    glUniform1i(renderShader->getUniform("pass"), (int)pass);
+    glDrawArrays(primitive, 0, buffer.size());
+}
+
+void HardwareRenderer::flush() {
+    if (buffer.empty()) return;
+
+    updateReadTexture();
+    setupState();
+
+    renderShader->use();
+    glUniform1i(renderShader->getUniform("vram"), 0);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, readTex);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, buffer.size() * sizeof(Vertex), buffer.data());
+
+    if (blendMode == NO_BLENDING) {
+        setBlending(NO_BLENDING);
+        drawPass(Pass::Opaque);
+    } else {
+        // Texels without semi-transparency bit are drawn opaque, the rest is blended
+        setBlending(NO_BLENDING);
+        drawPass(Pass::OpaqueTexels);
+        setBlending(blendMode);
+        drawPass(Pass::TransparentTexels);
+    }
+
+    setBlending(NO_BLENDING);
+    glDisable(GL_SCISSOR_TEST);
+    glBindVertexArray(0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    buffer.clear();
+    readTexDirty = true;
+}
+
+void HardwareRenderer::prepareBatch(GLenum primitive, const Vertex& v, int count) {
+    int mode = (v.flags & Vertex::SemiTransparency) ? (v.flags >> 5) & 3 : NO_BLENDING;
+
+    bool areaChanged = drawingArea.left != gpu->drawingArea.left || drawingArea.top != gpu->drawingArea.top
+                       || drawingArea.right != gpu->drawingArea.right || drawingArea.bottom != gpu->drawingArea.bottom;
+
+    if (primitive != this->primitive || mode != blendMode || areaChanged || buffer.size() + count > MAX_VERTICES) {
+        flush();
+    }
+
+    this->primitive = primitive;
+    blendMode = mode;
+    drawingArea = gpu->drawingArea;
+}
+
+void HardwareRenderer::drawTriangles(const Vertex* v, int count) {
+    prepareBatch(GL_TRIANGLES, v[0], count);
+    buffer.insert(buffer.end(), v, v + count);
+}
+
+void HardwareRenderer::drawLine(const Vertex v[2]) {
+    prepareBatch(GL_LINES, v[0], 2);
+    buffer.insert(buffer.end(), v, v + 2);
+}
+
+void HardwareRenderer::fillRectangle(int x, int y, int w, int h, uint16_t color) {
+    flush();
+
+    PSXColor c = color;
+    glBindFramebuffer(GL_FRAMEBUFFER, vramFbo);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(x, y, w, h);
+    glClearColor(c.r / 31.f, c.g / 31.f, c.b / 31.f, 0.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+    glDisable(GL_SCISSOR_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    readTexDirty = true;
+}
+
+void HardwareRenderer::uploadVram(int x, int y, int w, int h) {
+    flush();
+
+    glBindTexture(GL_TEXTURE_2D, vramTex);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, VRAM_WIDTH);
+
+    // Transfers wrap around VRAM edges
+    for (int by = y; by < y + h;) {
+        int sy = by % VRAM_HEIGHT;
+        int sh = std::min(y + h - by, VRAM_HEIGHT - sy);
+        for (int bx = x; bx < x + w;) {
+            int sx = bx % VRAM_WIDTH;
+            int sw = std::min(x + w - bx, VRAM_WIDTH - sx);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, sx, sy, sw, sh, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, &gpu->vram[sy * VRAM_WIDTH + sx]);
+            bx += sw;
+        }
+        by += sh;
+    }
+
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    readTexDirty = true;
+}
+
+void HardwareRenderer::copyVram(int srcX, int srcY, int dstX, int dstY, int w, int h) {
+    flush();
+    updateReadTexture();
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFbo);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, vramFbo);
+
+    // Split copy into pieces that don't cross VRAM edge (neither in source nor in destination)
+    for (int y = 0; y < h;) {
+        int sy = (srcY + y) % VRAM_HEIGHT;
+        int dy = (dstY + y) % VRAM_HEIGHT;
+        int ch = std::min({h - y, VRAM_HEIGHT - sy, VRAM_HEIGHT - dy});
+        for (int x = 0; x < w;) {
+            int sx = (srcX + x) % VRAM_WIDTH;
+            int dx = (dstX + x) % VRAM_WIDTH;
+            int cw = std::min({w - x, VRAM_WIDTH - sx, VRAM_WIDTH - dx});
+            glBlitFramebuffer(sx, sy, sx + cw, sy + ch, dx, dy, dx + cw, dy + ch, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            x += cw;
+        }
+        y += ch;
+    }
+
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    readTexDirty = true;
+}
+
+void HardwareRenderer::readVram(int x, int y, int w, int h) {
+    flush();
+
+    // Whole rows are read, so horizontal wrapping doesn't need any special handling
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, vramFbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 2);
+    for (int by = y; by < y + h;) {
+        int sy = by % VRAM_HEIGHT;
+        int sh = std::min(y + h - by, VRAM_HEIGHT - sy);
+        glReadPixels(0, sy, VRAM_WIDTH, sh, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, &gpu->vram[sy * VRAM_WIDTH]);
+        by += sh;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <glad/glad.h>
+#include <memory>
+#include <vector>
+#include "device/gpu/gpu.h"
+#include "shader/Program.h"
+
+/**
+ * GPU backend rasterizing primitives with OpenGL 3.2.
+ * VRAM lives in 1024x512 RGB5A1 texture used as a framebuffer, primitives are collected
+ * into vertex buffer and drawn in batches (flushed on blending or drawing area change and before VRAM transfers).
+ * Uses only glad, so it works with any current GL context (SDL window, EGL or OSMesa surface).
+ */
+class HardwareRenderer : public RenderBackend {
+   public:
+    ~HardwareRenderer();
+
+    bool setup();
+
+    // Uploads whole gpu->vram and starts handling GPU primitives
+    void attach(GPU* gpu);
+
+    // Synchronizes gpu->vram and returns to software rendering
+    void detach();
+
+    bool isAttached() const { return gpu != nullptr; }
+
+    // Draws all pending primitives
+    void flush();
+
+    GLuint getVramTextureId() const { return vramTex; }
+
+    void drawTriangles(const Vertex* v, int count) override;
+    void drawLine(const Vertex v[2]) override;
+    void fillRectangle(int x, int y, int w, int h, uint16_t color) override;
+    void uploadVram(int x, int y, int w, int h) override;
+    void copyVram(int srcX, int srcY, int dstX, int dstY, int w, int h) override;
+    void readVram(int x, int y, int w, int h) override;
+
+   private:
+    enum class Pass { Opaque = 0, OpaqueTexels = 1, TransparentTexels = 2 };
+    static const int NO_BLENDING = -1;
+    static const int MAX_VERTICES = 32 * 1024;
+
+    GPU* gpu = nullptr;
+
+    std::unique_ptr<Program> renderShader;
+
+    GLuint vao = 0;
+    GLuint vbo = 0;
+
+    // Render target, mirrors VRAM
+    GLuint vramTex = 0;
+    GLuint vramFbo = 0;
+
+    // Copy of VRAM sampled by shaders (texture cannot be sampled and rendered at the same time)
+    GLuint readTex = 0;
+    GLuint readFbo = 0;
+    bool readTexDirty = true;
+
+    std::vector<Vertex> buffer;
+    GLenum primitive = GL_TRIANGLES;
+    int blendMode = NO_BLENDING;
+    Rect<int16_t> drawingArea;
+
+    void createVramTextures();
+    void createVertexBuffer();
+    void setupState();
+    void updateReadTexture();
+    void setBlending(int mode);
+    void drawPass(Pass pass);
+    void prepareBatch(GLenum primitive, const Vertex& v, int count);
+};
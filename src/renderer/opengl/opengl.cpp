@@ -1,6 +1,7 @@
 #include "opengl.h"
 #include <SDL.h>
 #include <glad/glad.h>
+#include <algorithm>
 #include <memory>
 #include "config.h"
 #include "device/gpu/gpu.h"
@@ -64,17 +65,33 @@ void OpenGL::createBlitBuffer() {
 
 void OpenGL::createRenderTexture() {
     glGenTextures(1, &renderTex);
-    glBindTexture(GL_TEXTURE_2D, renderTex);
+    glGenBuffers(2, uploadPbo);
+    // Storage is allocated on first upload, when VRAM size is known
+}
 
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, nullptr);
+void OpenGL::loadSettings() {
+    settings.filtering = config["options"]["graphics"]["filtering"];
+    settings.widescreen = config["options"]["graphics"]["widescreen"];
+    settings.hardwareRendering = config["options"]["graphics"]["hardwareRendering"];
+    settings.resolutionMultiplier = config["options"]["graphics"]["resolutionMultiplier"];
+    settings.frameSkip = config["options"]["graphics"]["frameSkip"];
 
-    updateTextureParameters();
+    settingsRevision = configRevision;
+    configuredTexture = 0;
 }
 
-void OpenGL::updateTextureParameters() {
-    bool smoothing = config["options"]["graphics"]["filtering"];
+bool OpenGL::isFrameSkipEnabled() {
+    if (settingsRevision != configRevision) loadSettings();
+    return settings.frameSkip;
+}
 
-    glBindTexture(GL_TEXTURE_2D, renderTex);
+void OpenGL::updateTextureParameters(GLuint texture) {
+    if (texture == configuredTexture) return;
+    configuredTexture = texture;
+
+    bool smoothing = settings.filtering;
+
+    glBindTexture(GL_TEXTURE_2D, texture);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, smoothing ? GL_LINEAR : GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, smoothing ? GL_LINEAR : GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
@@ -91,22 +108,117 @@ bool OpenGL::setup() {
     createBlitBuffer();
     createRenderTexture();
 
+    hardwareRendererAvailable = hardwareRenderer.setup();
+    if (!hardwareRendererAvailable) {
+        printf("Hardware renderer unavailable, using software rendering\n");
+    }
+
     return true;
 }
 
-void OpenGL::renderSecondStage() {
+void OpenGL::renderSecondStage(GPU *gpu, GLuint texture) {
     blitShader->use();
     glBindVertexArray(blitVao);
 
+    // Display area is decoded in shader, full VRAM view is always shown as 15 bit
+    bool colorDepth24 = !viewFullVram && gpu->gp1_08.colorDepth == GP1_08::ColorDepth::bit24;
+    glUniform1i(blitShader->getUniform("renderBuffer"), 0);
+    glUniform1i(blitShader->getUniform("filtering"), settings.filtering);
+    glUniform1i(blitShader->getUniform("colorDepth24"), colorDepth24);
+    glUniform2i(blitShader->getUniform("displayStart"), gpu->displayAreaStartX, gpu->displayAreaStartY);
+
     glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, renderTex);
+    glBindTexture(GL_TEXTURE_2D, texture);
 
     glDrawArrays(GL_TRIANGLES, 0, 6);
 }
 
+void OpenGL::uploadVram(GPU *gpu) {
+    int width = gpu->getVramWidth();
+    int height = gpu->getVramHeight();
+    GLsizeiptr size = width * height * sizeof(uint16_t);
+
+    // Reallocate only when internal resolution changes
+    if (width != renderTexWidth || height != renderTexHeight) {
+        glBindTexture(GL_TEXTURE_2D, renderTex);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, nullptr);
+        for (GLuint pbo : uploadPbo) {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        renderTexWidth = width;
+        renderTexHeight = height;
+        gpu->dirtyTiles.set();
+    }
+
+    if (gpu->dirtyTiles.none()) return;
+
+    // Dirty tiles are merged into horizontal runs, every run is staged at its VRAM offset
+    struct Run {
+        int x, y, w, h;
+    };
+    std::vector<Run> runs;
+
+    int tileSize = VRAM_TILE_SIZE * gpu->resolutionMultiplier;
+    for (int ty = 0; ty < VRAM_TILES_Y; ty++) {
+        for (int tx = 0; tx < VRAM_TILES_X;) {
+            if (!gpu->dirtyTiles.test(ty * VRAM_TILES_X + tx)) {
+                tx++;
+                continue;
+            }
+            int start = tx;
+            while (tx < VRAM_TILES_X && gpu->dirtyTiles.test(ty * VRAM_TILES_X + tx)) tx++;
+            runs.push_back({start * tileSize, ty * tileSize, (tx - start) * tileSize, tileSize});
+        }
+    }
+    gpu->clearDirtyTiles();
+
+    uploadPboIndex ^= 1;
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploadPbo[uploadPboIndex]);
+    auto *staging = (uint16_t *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (staging == nullptr) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        gpu->dirtyTiles.set();
+        return;
+    }
+    for (const auto &r : runs) {
+        for (int y = r.y; y < r.y + r.h; y++) {
+            std::copy_n(&gpu->vram[y * width + r.x], r.w, &staging[y * width + r.x]);
+        }
+    }
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+    // Transfers from PBO are asynchronous, emulation continues while driver copies the data
+    glBindTexture(GL_TEXTURE_2D, renderTex);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    for (const auto &r : runs) {
+        auto offset = (const void *)(uintptr_t)((r.y * width + r.x) * sizeof(uint16_t));
+        glTexSubImage2D(GL_TEXTURE_2D, 0, r.x, r.y, r.w, r.h, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, offset);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 void OpenGL::render(GPU *gpu) {
+    if (settingsRevision != configRevision) loadSettings();
+
+    bool hardwareRendering = hardwareRendererAvailable && settings.hardwareRendering;
+    if (!hardwareRendering && hardwareRenderer.isAttached()) {
+        hardwareRenderer.detach();
+    }
+
+    // Internal resolution is used only by software renderer
+    gpu->setResolutionMultiplier(hardwareRendering ? 1 : settings.resolutionMultiplier);
+
+    if (hardwareRendering && gpu->backend != &hardwareRenderer) {
+        // Also reattaches after GPU has been recreated (eg. hard reset)
+        hardwareRenderer.attach(gpu);
+    }
+
     // Viewport settings
-    aspect = config["options"]["graphics"]["widescreen"] ? RATIO_16_9 : RATIO_4_3;
+    aspect = settings.widescreen ? RATIO_16_9 : RATIO_4_3;
 
     int x = 0;
     int y = 0;
@@ -137,17 +249,21 @@ void OpenGL::render(GPU *gpu) {
     glBindBuffer(GL_ARRAY_BUFFER, blitVbo);
     glBufferSubData(GL_ARRAY_BUFFER, 0, bb.size() * sizeof(BlitStruct), bb.data());
 
-    // Update Render texture
-    updateTextureParameters();
-    glBindTexture(GL_TEXTURE_2D, renderTex);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1024, 512, 0, GL_RGBA, GL_UNSIGNED_SHORT_1_5_5_5_REV, gpu->vram.data());
-    // TODO: Remove 1_5_5_5, move to RGB888
+    GLuint texture = renderTex;
+    if (hardwareRenderer.isAttached()) {
+        hardwareRenderer.flush();
+        texture = hardwareRenderer.getVramTextureId();
+        updateTextureParameters(texture);
+    } else {
+        uploadVram(gpu);
+        updateTextureParameters(renderTex);
+    }
 
     glClearColor(0.f, 0.f, 0.f, 1.f);
     glClear(GL_COLOR_BUFFER_BIT);
 
     glViewport(x, y, w, h);
-    renderSecondStage();
+    renderSecondStage(gpu, texture);
 
     glViewport(0, 0, width, height);
 }
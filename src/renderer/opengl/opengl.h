@@ -2,6 +2,7 @@
 #include <glad/glad.h>
 #include <memory>
 #include "device/gpu/gpu.h"
+#include "hardware_renderer.h"
 #include "shader/Program.h"
 
 class OpenGL {
@@ -24,8 +25,11 @@ class OpenGL {
 
     bool getViewFullVram() { return viewFullVram; }
 
+    // Frame skipping is decided by main loop, option is cached with the rest of settings
+    bool isFrameSkipEnabled();
+
     // Debug
-    GLuint getVramTextureId() const { return renderTex; }
+    GLuint getVramTextureId() const { return hardwareRenderer.isAttached() ? hardwareRenderer.getVramTextureId() : renderTex; }
 
    private:
     struct BlitStruct {
@@ -33,16 +37,39 @@ class OpenGL {
         float tex[2];
     };
 
+    // Graphics options, reloaded only when config changes
+    struct Settings {
+        bool filtering = false;
+        bool widescreen = false;
+        bool hardwareRendering = false;
+        int resolutionMultiplier = 1;
+        bool frameSkip = false;
+    };
+
     const int bufferSize = 1024 * 1024;
 
-    std::unique_ptr<Program> renderShader;
+    Settings settings;
+    uint32_t settingsRevision = ~0u;
+
     std::unique_ptr<Program> blitShader;
 
+    HardwareRenderer hardwareRenderer;
+    bool hardwareRendererAvailable = false;
+
     // VRAM to screen blit
     GLuint blitVao = 0;
     GLuint blitVbo = 0;
 
     GLuint renderTex = 0;
+    int renderTexWidth = 0;
+    int renderTexHeight = 0;
+
+    // Double buffered staging for VRAM uploads, driver copies one while the other is filled
+    GLuint uploadPbo[2] = {};
+    int uploadPboIndex = 0;
+
+    // Texture which has currently applied filtering parameters
+    GLuint configuredTexture = 0;
 
     bool viewFullVram = false;
 
@@ -51,7 +78,9 @@ class OpenGL {
     void createBlitBuffer();
     void createVramTexture();
     void createRenderTexture();
-    void updateTextureParameters();
+    void loadSettings();
+    void updateTextureParameters(GLuint texture);
+    void uploadVram(GPU* gpu);
     std::vector<BlitStruct> makeBlitBuf(int screenX = 0, int screenY = 0, int screenW = 640, int screenH = 480);
-    void renderSecondStage();
+    void renderSecondStage(GPU* gpu, GLuint texture);
 };
\ No newline at end of file
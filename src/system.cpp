@@ -15,6 +15,7 @@ System::System() {
 
     cpu = std::make_unique<mips::CPU>(this);
     gpu = std::make_unique<GPU>();
+    spu = std::make_unique<SPU>();  // Used by DMA channels
 
     cdrom = std::make_unique<device::cdrom::CDROM>(this);
     controller = std::make_unique<device::controller::Controller>(this);
@@ -24,7 +25,6 @@ System::System() {
     mdec = std::make_unique<MDEC>();
     memoryControl = std::make_unique<MemoryControl>();
     serial = std::make_unique<Serial>();
-    spu = std::make_unique<SPU>();
     timer0 = std::make_unique<Timer<0>>(this);
     timer1 = std::make_unique<Timer<1>>(this);
     timer2 = std::make_unique<Timer<2>>(this);
@@ -104,7 +104,7 @@ INLINE bool in_range(const uint32_t addr) {
 }
 
 #ifdef ENABLE_IO_LOG
-#define LOG_IO(mode, size, addr, data, pc) ioLogList.push_back({(mode), (size), (addr), (data), (pc)})
+#define LOG_IO(mode, size, addr, data, pc) ioLog.push({(mode), (size), (addr), (data), (pc)})
 #else
 #define LOG_IO(mode, size, addr, data, pc)
 #endif
@@ -284,14 +284,16 @@ void System::singleStep() {
     state = State::run;
     cpu->executeInstructions(1);
     state = State::pause;
+    cycles += 3;
 
-    dma->step();
+    dma->step(3);
     cdrom->step();
-    timer0->step(3);
-    timer1->step(3);
-    timer2->step(3);
+    timer0->step();
+    timer1->step();
+    timer2->step();
     controller->step();
 
+    if (gpu->pollIrq()) interrupt->trigger(interrupt::GPU);
     if (gpu->emulateGpuCycles(3)) {
         interrupt->trigger(interrupt::VBLANK);
     }
@@ -299,29 +301,32 @@ void System::singleStep() {
 
 void System::emulateFrame() {
 #ifdef ENABLE_IO_LOG
-    ioLogList.clear();
+    ioLog.clear();
 #endif
     cpu->gte.log.clear();
-    gpu->gpuLogList.clear();
+    gpu->gpuLog.clear();
 
-    gpu->prevVram = gpu->vram;
+    gpu->beginFrame();
     int systemCycles = 300;
     for (;;) {
-        if (!cpu->executeInstructions(systemCycles / 3)) {
+        // CPU doesn't execute while DMA uses the bus
+        if (!cpu->executeInstructions((systemCycles - dmaCycles) / 3)) {
             // printf("CPU Halted\n");
             return;
         }
 
-        dma->step();
+        cycles += systemCycles;
+
+        dmaCycles = dma->step(systemCycles);
         cdrom->step();
-        timer0->step(systemCycles);
-        timer1->step(systemCycles);
-        timer2->step(systemCycles);
 
-        static int wtf = 0;
-        if (++wtf % 200 == 0) interrupt->trigger(interrupt::TIMER2);
+        // Timers are only stepped when their IRQ is due, registers are updated lazily on access
+        if (cycles >= timer0->nextEvent()) timer0->step();
+        if (cycles >= timer1->nextEvent()) timer1->step();
+        if (cycles >= timer2->nextEvent()) timer2->step();
         controller->step();
 
+        if (gpu->pollIrq()) interrupt->trigger(interrupt::GPU);
         if (gpu->emulateGpuCycles(systemCycles)) {
             interrupt->trigger(interrupt::VBLANK);
             return;  // frame emulated
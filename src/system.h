@@ -12,6 +12,7 @@
 #include "device/serial.h"
 #include "device/spu.h"
 #include "device/timer.h"
+#include "utils/log_buffer.h"
 #include "utils/macros.h"
 
 #include <memory>
@@ -79,6 +80,8 @@ struct System {
     uint8_t expansion[EXPANSION_SIZE];
 
     bool debugOutput = true;  // Print BIOS logs
+    int dmaCycles = 0;        // Cycles of last step CPU was stopped for by DMA
+    uint64_t cycles = 0;      // System cycles emulated since power on, timers are computed from it
 
     // Devices
     std::unique_ptr<mips::CPU> cpu;
@@ -133,6 +136,6 @@ struct System {
         uint32_t pc;
     };
 
-    std::vector<IO_LOG_ENTRY> ioLogList;
+    LogBuffer<IO_LOG_ENTRY, 0x40000> ioLog;
 #endif
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+
+/**
+ * Fixed capacity FIFO of device registers (CDROM parameters and responses, SIO RX), stored inline without allocations.
+ * Like hardware queues it never grows - pushing to full FIFO drops the value, popping from empty one returns T().
+ */
+template <typename T, size_t capacity>
+class Fifo {
+    T data[capacity] = {};
+    size_t head = 0;  // Index of the oldest element
+    size_t count = 0;
+
+   public:
+    bool empty() const { return count == 0; }
+    bool full() const { return count == capacity; }
+    size_t size() const { return count; }
+    void clear() { head = count = 0; }
+
+    bool push(T value) {
+        if (full()) return false;
+        data[(head + count) % capacity] = value;
+        count++;
+        return true;
+    }
+
+    T pop() {
+        if (empty()) return T();
+        T value = data[head];
+        head = (head + 1) % capacity;
+        count--;
+        return value;
+    }
+
+    T front() const { return empty() ? T() : data[head]; }
+
+    // Newest element, FIFO must not be empty
+    T& back() { return data[(head + count - 1) % capacity]; }
+
+    // i-th oldest element
+    T operator[](size_t i) const { return data[(head + i) % capacity]; }
+};
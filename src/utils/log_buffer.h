@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "macros.h"
+
+/**
+ * Fixed capacity log of debug events, oldest entries are overwritten when full.
+ * Entries are filtered by category - value of T::mode, all categories are disabled by default
+ * and storage is allocated only when some of them get enabled.
+ *
+ * Not thread safe - entries are pushed and read (snapshot()) from the same thread, between emulated frames.
+ */
+template <typename T, size_t capacity>
+class LogBuffer {
+    std::vector<T> entries;
+    size_t head = 0;  // Total number of entries written since clear
+    uint32_t mask = 0;
+
+    static uint32_t category(const T& entry) { return 1u << static_cast<uint32_t>(entry.mode); }
+
+   public:
+    uint32_t enabled() const { return mask; }
+
+    // Bit n enables entries with mode n, 0 disables logging
+    void enable(uint32_t categories) {
+        if (categories != 0 && entries.empty()) entries.resize(capacity);
+        mask = categories;
+    }
+
+    INLINE void push(const T& entry) {
+        if (!(mask & category(entry))) return;
+
+        entries[head % capacity] = entry;
+        head++;
+    }
+
+    void clear() { head = 0; }
+
+    // Entries oldest first
+    std::vector<T> snapshot() const {
+        if (entries.empty()) return {};
+
+        size_t begin = head > capacity ? head - capacity : 0;
+
+        std::vector<T> copy;
+        copy.reserve(head - begin);
+        for (size_t i = begin; i < head; i++) copy.push_back(entries[i % capacity]);
+        return copy;
+    }
+};
@@ -1,6 +1,9 @@
 #pragma once
 #include <algorithm>
 #include <cstdint>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 template <size_t from, size_t to>
 bool or_range(uint32_t v) {
@@ -32,4 +35,14 @@ T extend_sign(uint32_t n) {
     T val = n & mask;
     if (sign) val |= ~mask;
     return val;
-}
\ No newline at end of file
+}
+
+// Number of leading zero bits, 32 for 0
+inline int clz(uint32_t n) {
+#ifdef _MSC_VER
+    unsigned long index;
+    return _BitScanReverse(&index, n) ? 31 - index : 32;
+#else
+    return n == 0 ? 32 : __builtin_clz(n);
+#endif
+}
@@ -4,4 +4,8 @@
 #define INLINE __forceinline
 #else
 #define INLINE __attribute__((always_inline))
-#endif
\ No newline at end of file
+#endif
+// SSE2 is always available on x64, MSVC doesn't define __SSE2__ for it
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HAS_SSE2
+#endif
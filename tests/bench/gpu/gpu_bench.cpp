@@ -0,0 +1,258 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device/gpu/display.h"
+#include "device/gpu/gpu.h"
+#include "utils/file.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+void printHelp() {
+    printf(R"(
+usage: avocado_gpubench [options] capture.gpulog [capture2.gpulog ...]
+  --iterations N - replay every capture N times (default 100)
+  --scale N      - internal resolution multiplier (default 1)
+  --hash H       - expected VRAM hash (hex) after single replay of all captures
+  --dump FILE    - write display area of last capture after single replay as .ppm
+  --gp1 W        - GP1 command (hex) applied before dump, display state is not captured (may be repeated)
+  --help         - print help
+)");
+}
+
+struct Stats {
+    Command type = Command::None;
+    uint64_t count = 0;
+    uint64_t pixels = 0;
+    Clock::duration time = Clock::duration::zero();
+};
+
+struct Capture {
+    std::string path;
+    std::unique_ptr<GPU> gpu;
+    std::vector<uint32_t> words;  // Commands rebuilt from log, ready to be written to GP0
+    std::vector<size_t> offsets;  // Command index -> position in words
+};
+
+// Estimated number of pixels touched by command, based on its arguments (native resolution)
+uint64_t estimatePixels(const CommandLog::Entry& e) {
+    auto x = [](uint32_t a) { return (int)(int16_t)(a & 0xffff); };
+    auto y = [](uint32_t a) { return (int)(int16_t)(a >> 16); };
+    const uint32_t* a = e.args;
+
+    if (e.cmd == Command::FillRectangle || e.cmd == Command::CopyVramToVram) {
+        int i = e.cmd == Command::FillRectangle ? 2 : 3;
+        if ((int)e.argCount <= i) return 0;
+        return (uint64_t)(a[i] & 0x3ff) * ((a[i] >> 16) & 0x1ff);
+    }
+    if (e.cmd == Command::Rectangle) {
+        RectangleArgs arg(e.command);
+        if (arg.size != 0) return arg.getSize() * arg.getSize();
+        uint32_t size = a[arg.isTextureMapped ? 3 : 2];
+        return (uint64_t)std::abs(x(size)) * std::abs(y(size));
+    }
+    if (e.cmd == Command::Polygon) {
+        PolygonArgs arg(e.command);
+        int stride = 1 + arg.isTextureMapped + arg.gouroudShading;
+        int px[4], py[4];
+        for (int i = 0; i < arg.getVertexCount(); i++) {
+            uint32_t v = a[1 + i * stride];
+            px[i] = x(v);
+            py[i] = y(v);
+        }
+        auto area = [&](int i0, int i1, int i2) {
+            return (uint64_t)std::abs((px[i1] - px[i0]) * (py[i2] - py[i0]) - (px[i2] - px[i0]) * (py[i1] - py[i0])) / 2;
+        };
+        return area(0, 1, 2) + (arg.isQuad ? area(1, 2, 3) : 0);
+    }
+    if (e.cmd == Command::Line) {
+        LineArgs arg(e.command);
+        int stride = 1 + arg.gouroudShading;
+        uint64_t pixels = 0;
+        for (size_t i = 1; i + stride < e.argCount; i += stride) {
+            uint32_t v0 = a[i], v1 = a[i + stride];
+            if ((v1 & 0xf000f000) == 0x50005000) break;
+            pixels += std::max(std::abs(x(v1) - x(v0)), std::abs(y(v1) - y(v0))) + 1;
+        }
+        return pixels;
+    }
+    return 0;
+}
+
+// Binary PPM, alpha is dropped
+bool dumpDisplay(GPU* gpu, const std::string& path) {
+    std::vector<uint32_t> rgba;
+    int width, height;
+    if (!decodeDisplay(gpu, rgba, width, height)) return false;
+
+    std::string file = "P6\n" + std::to_string(width) + " " + std::to_string(height) + "\n255\n";
+    for (uint32_t p : rgba) {
+        file += (char)(p & 0xff);
+        file += (char)((p >> 8) & 0xff);
+        file += (char)((p >> 16) & 0xff);
+    }
+    return putFileContents(path, file);
+}
+
+// FNV-1a over whole VRAM
+uint64_t hashVram(const std::vector<uint16_t>& vram) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint16_t p : vram) {
+        hash = (hash ^ (p & 0xff)) * 0x100000001b3ull;
+        hash = (hash ^ (p >> 8)) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 100;
+    int scale = 1;
+    bool checkHash = false;
+    uint64_t expectedHash = 0;
+    std::string dumpPath;
+    std::vector<uint32_t> gp1;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--scale") == 0 && i + 1 < argc) {
+            scale = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--hash") == 0 && i + 1 < argc) {
+            checkHash = true;
+            expectedHash = strtoull(argv[++i], nullptr, 16);
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dumpPath = argv[++i];
+        } else if (strcmp(argv[i], "--gp1") == 0 && i + 1 < argc) {
+            gp1.push_back(strtoul(argv[++i], nullptr, 16));
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printHelp();
+            return 0;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.empty()) {
+        printHelp();
+        return 0;
+    }
+
+    std::vector<Capture> captures;
+    std::vector<CommandLog::Entry> entries;
+    int skipped = 0;
+    for (auto& file : files) {
+        Capture c;
+        c.path = file;
+        c.gpu = std::make_unique<GPU>();
+        c.gpu->setResolutionMultiplier(scale);
+        if (!fileExists(file) || !c.gpu->loadLogCapture(file)) {
+            printf("Cannot load capture %s\n", file.c_str());
+            return 1;
+        }
+        c.gpu->gpuLogEnabled = false;
+
+        const auto& log = c.gpu->gpuLog;
+        for (size_t i = 0; i < log.size(); i++) {
+            auto e = log[i];
+            // Transfer data is not logged, replaying it would desynchronize command stream
+            if (e.cmd == Command::CopyCpuToVram1 || e.argCount == 0) {
+                skipped++;
+                continue;
+            }
+            c.offsets.push_back(c.words.size());
+            c.words.push_back(e.args[0] | (e.command << 24));
+            c.words.insert(c.words.end(), e.args + 1, e.args + e.argCount);
+            entries.push_back(e);
+        }
+        c.offsets.push_back(c.words.size());
+        printf("Capture %s: %zu commands\n", file.c_str(), c.offsets.size() - 1);
+        captures.push_back(std::move(c));
+    }
+    if (skipped > 0) printf("Skipped %d CPU to VRAM transfers (data is not logged)\n", skipped);
+
+    // Stats are indexed by GP0 opcode
+    Stats stats[256];
+    uint64_t primitives = 0;
+    uint64_t pixels = 0;
+    uint64_t hash = 0;
+    uint64_t lastHash = 0;
+    Clock::duration total = Clock::duration::zero();
+
+    for (int it = 0; it < iterations; it++) {
+        size_t entry = 0;
+        lastHash = 0;
+        for (auto& c : captures) {
+            GPU* gpu = c.gpu.get();
+            gpu->restoreFrameStart();
+
+            for (size_t i = 0; i + 1 < c.offsets.size(); i++, entry++) {
+                const auto& e = entries[entry];
+                auto start = Clock::now();
+                for (size_t w = c.offsets[i]; w < c.offsets[i + 1]; w++) {
+                    gpu->writeGP0(c.words[w]);
+                }
+                auto time = Clock::now() - start;
+
+                auto& s = stats[e.command];
+                s.type = e.cmd;
+                s.count++;
+                s.time += time;
+                total += time;
+
+                if (it == 0) s.pixels += estimatePixels(e);
+                if (e.cmd == Command::Polygon || e.cmd == Command::Rectangle || e.cmd == Command::Line) primitives++;
+            }
+
+            if (it == 0 || it == iterations - 1) {
+                lastHash = lastHash * 31 + hashVram(gpu->vram);
+            }
+        }
+        if (it == 0) {
+            hash = lastHash;
+            if (!dumpPath.empty()) {
+                GPU* gpu = captures.back().gpu.get();
+                // Dumped display is enabled by default, mode and position come from --gp1
+                gpu->writeGP1(0x03000000);
+                for (uint32_t cmd : gp1) gpu->writeGP1(cmd);
+
+                if (!dumpDisplay(gpu, dumpPath)) {
+                    printf("Cannot dump display to %s\n", dumpPath.c_str());
+                    return 1;
+                }
+                printf("Display dumped to %s\n", dumpPath.c_str());
+            }
+        }
+    }
+    for (auto& s : stats) pixels += s.pixels * iterations;
+
+    double seconds = std::chrono::duration<double>(total).count();
+    printf("\nReplayed %d times in %.3f s (%.1f frames/s)\n", iterations, seconds, iterations * captures.size() / seconds);
+    printf("Primitives: %.0f/s\n", primitives / seconds);
+    printf("Pixels (estimated): %.2f M/s\n", pixels / seconds / 1e6);
+
+    printf("\n  cmd  type              count       ns/cmd   pixels/cmd   time\n");
+    for (int i = 0; i < 256; i++) {
+        const auto& s = stats[i];
+        if (s.count == 0) continue;
+        double ns = std::chrono::duration<double, std::nano>(s.time).count();
+        printf("  0x%02x %-16s %8" PRIu64 " %12.1f %12.1f %6.2f%%\n", i, CommandStr[(int)s.type], s.count, ns / s.count,
+               (double)s.pixels * iterations / s.count, 100.0 * s.time.count() / total.count());
+    }
+
+    printf("\nVRAM hash: %016" PRIx64 "\n", hash);
+    if (lastHash != hash) {
+        printf("Replay is not deterministic, last iteration hash: %016" PRIx64 "\n", lastHash);
+        return 1;
+    }
+    if (checkHash && hash != expectedHash) {
+        printf("Hash mismatch, expected %016" PRIx64 "\n", expectedHash);
+        return 1;
+    }
+
+    return 0;
+}
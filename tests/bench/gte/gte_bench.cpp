@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+#include "cpu/gte/gte.h"
+
+using Clock = std::chrono::high_resolution_clock;
+
+void printHelp() {
+    printf(R"(
+usage: avocado_gtebench [options]
+  --iterations N - commands executed per opcode and sf/lm variant (default 200000)
+  --flag         - read FLAG after every command (disables lazy FLAG calculation)
+  --fuzz N       - compare alternative implementations with GTE::command on N random cases instead of benchmark
+  --seed S       - fuzz random seed (default 1)
+  --help         - print help
+)");
+}
+
+struct Opcode {
+    uint32_t cmd;
+    const char* name;
+    int result;  // Register read after command, like game storing the result
+};
+
+// MVMVA is benchmarked with the most common variant - RT * V0 + TR
+const Opcode opcodes[] = {
+    {0x01, "RTPS", 14},  {0x06, "NCLIP", 24}, {0x0c, "OP", 25},    {0x10, "DPCS", 22},  {0x11, "INTPL", 22}, {0x12, "MVMVA", 9},
+    {0x13, "NCDS", 22},  {0x14, "CDP", 22},   {0x16, "NCDT", 22},  {0x1b, "NCCS", 22},  {0x1c, "CC", 22},    {0x1e, "NCS", 22},
+    {0x20, "NCT", 22},   {0x28, "SQR", 9},    {0x29, "DCPL", 22},  {0x2a, "DPCT", 22},  {0x2d, "AVSZ3", 7},  {0x2e, "AVSZ4", 7},
+    {0x30, "RTPT", 14},  {0x3d, "GPF", 9},    {0x3e, "GPL", 9},    {0x3f, "NCCT", 22},
+};
+
+uint32_t pack(int16_t lo, int16_t hi) { return (uint16_t)lo | ((uint32_t)(uint16_t)hi << 16); }
+
+// Writes 3x3 matrix (1.3.12 fixed point) starting at control register 32 + first
+void writeMatrix(GTE& gte, int first, const double m[3][3]) {
+    int16_t e[9];
+    for (int i = 0; i < 9; i++) e[i] = (int16_t)std::lround(m[i / 3][i % 3] * 4096.0);
+    for (int i = 0; i < 4; i++) gte.write(32 + first + i, pack(e[i * 2], e[i * 2 + 1]));
+    gte.write(32 + first + 4, (uint32_t)(int32_t)e[8]);
+}
+
+// Scene similar to what games set up: camera rotation, 3 directional lights, fog and screen projection
+void setupScene(GTE& gte) {
+    const double a = 0.4, b = 0.7;
+    const double rotation[3][3] = {
+        {cos(b), 0, sin(b)},
+        {sin(a) * sin(b), cos(a), -sin(a) * cos(b)},
+        {-cos(a) * sin(b), sin(a), cos(a) * cos(b)},
+    };
+    const double lights[3][3] = {{0.57, -0.57, 0.57}, {-0.7, 0.0, 0.7}, {0.0, 0.99, 0.0}};
+    const double colors[3][3] = {{0.9, 0.3, 0.1}, {0.8, 0.3, 0.1}, {0.7, 0.3, 0.1}};
+
+    writeMatrix(gte, 0, rotation);
+    gte.write(37, 0);     // TRX
+    gte.write(38, 0);     // TRY
+    gte.write(39, 2000);  // TRZ
+    writeMatrix(gte, 8, lights);
+    for (int i = 0; i < 3; i++) gte.write(45 + i, 0x200);  // BK
+    writeMatrix(gte, 16, colors);
+    for (int i = 0; i < 3; i++) gte.write(53 + i, 0x800);  // FC
+    gte.write(56, 160 << 16);                               // OFX
+    gte.write(57, 120 << 16);                               // OFY
+    gte.write(58, 300);                                     // H
+    gte.write(59, (uint32_t)-0x100);                        // DQA
+    gte.write(60, 0x1000000);                               // DQB
+    gte.write(61, 0x155);                                   // ZSF3
+    gte.write(62, 0x100);                                   // ZSF4
+
+    gte.write(2, pack(-300, 200));  // V1
+    gte.write(3, 150);
+    gte.write(4, pack(250, -100));  // V2
+    gte.write(5, -200);
+    gte.write(6, 0x30808080);  // RGBC
+    gte.write(8, 0x800);       // IR0
+    for (int i = 0; i < 3; i++) gte.write(9 + i, 0x400 * (i + 1));
+    for (int i = 0; i < 4; i++) gte.write(16 + i, 0x1000 + i * 0x100);  // SZ0..3
+    for (int i = 0; i < 3; i++) gte.write(12 + i, pack(100 + i * 50, 80 + i * 30));
+}
+
+// Vertices of a model (sphere, radius 500) which are used as V0 of consecutive commands
+std::vector<uint32_t> makeVertices() {
+    std::vector<uint32_t> vertices;
+    for (int i = 0; i < 1024; i++) {
+        double theta = i * 0.1, phi = i * 0.37;
+        vertices.push_back(pack((int16_t)(500 * sin(theta) * cos(phi)), (int16_t)(500 * sin(theta) * sin(phi))));
+        vertices.push_back((uint32_t)(int32_t)(int16_t)(500 * cos(theta)));
+    }
+    return vertices;
+}
+
+// Time of executing n commands, loop also writes V0 and reads result register
+Clock::duration run(uint32_t command, int result, int n, bool readFlag, const std::vector<uint32_t>& vertices, uint32_t& checksum) {
+    GTE gte;
+    setupScene(gte);
+    gte::Command cmd(command);
+    size_t count = vertices.size() / 2;
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; i++) {
+        size_t v = (i % count) * 2;
+        gte.write(0, vertices[v]);
+        gte.write(1, vertices[v + 1]);
+        if (command != 0) gte.command(cmd);
+        checksum = checksum * 31 + gte.read(result);
+        if (readFlag) checksum ^= gte.read(63);
+    }
+    return Clock::now() - start;
+}
+
+double nanoseconds(Clock::duration d) { return std::chrono::duration<double, std::nano>(d).count(); }
+
+int benchmark(int iterations, bool readFlag) {
+    auto vertices = makeVertices();
+    uint32_t checksum = 0;
+    uint32_t ignored = 0;
+
+    // Register writes and reads done in the loop, subtracted from command times
+    double overhead = nanoseconds(run(0, 25, iterations, readFlag, vertices, ignored)) / iterations;
+
+    printf("Iterations per variant: %d, FLAG read: %s, loop overhead: %.1f ns\n", iterations, readFlag ? "every command" : "never", overhead);
+    printf("\n  op    name    sf=0 lm=0  sf=0 lm=1  sf=1 lm=0  sf=1 lm=1   (ns/cmd)\n");
+
+    double total = 0;
+    for (const auto& op : opcodes) {
+        printf("  0x%02x  %-6s", op.cmd, op.name);
+        for (int variant = 0; variant < 4; variant++) {
+            uint32_t command = op.cmd | ((variant & 1) << 10) | ((variant >> 1) << 19);
+            double ns = nanoseconds(run(command, op.result, iterations, readFlag, vertices, checksum)) / iterations;
+            ns = std::max(0.0, ns - overhead);
+            total += ns;
+            printf(" %10.1f", ns);
+        }
+        printf("\n");
+    }
+    printf("\nAverage: %.1f ns/cmd\n", total / (sizeof(opcodes) / sizeof(opcodes[0]) * 4));
+    printf("Result checksum: %08x\n", checksum);
+    return 0;
+}
+
+// Register values biased towards saturation and overflow boundaries
+uint32_t randomValue(std::mt19937& rng) {
+    static const uint16_t edges[] = {0x0000, 0x0001, 0x7fff, 0x8000, 0xffff, 0x1000, 0xf000};
+    uint32_t r = rng();
+    switch (rng() % 5) {
+        case 0: return r & 0xff;
+        case 1: return (uint32_t)(int32_t)(int16_t)r;
+        case 2: return r & 0x0fff0fff;
+        case 3: return edges[rng() % 7] | (edges[rng() % 7] << 16);
+        default: return r;
+    }
+}
+
+struct Implementation {
+    const char* name;
+    // Executes command, FLAG is compared after whole sequence
+    std::function<bool(GTE&, gte::Command&)> command;
+};
+
+// Reference is GTE::command with FLAG read right after every command (calculated eagerly or before any register change)
+bool reference(GTE& gte, gte::Command& cmd) {
+    bool valid = gte.command(cmd);
+    gte.read(63);
+    return valid;
+}
+
+const Implementation implementations[] = {
+    {"lazy FLAG", [](GTE& gte, gte::Command& cmd) { return gte.command(cmd); }},
+};
+
+int fuzz(int cases, uint32_t seed) {
+    std::mt19937 rng(seed);
+    int failed = 0;
+
+    for (const auto& impl : implementations) {
+        int mismatches = 0;
+        int executed = 0;
+        for (int c = 0; c < cases; c++) {
+            GTE ref, alt;
+            for (int r = 0; r < 64; r++) {
+                uint32_t value = randomValue(rng);
+                ref.write(r, value);
+                alt.write(r, value);
+            }
+
+            // Short sequence of commands, registers are modified between them like lwc2/ctc2 would do
+            std::vector<uint32_t> commands;
+            int length = 1 + rng() % 4;
+            for (int i = 0; i < length; i++) {
+                if (i > 0 && rng() % 2) {
+                    int r = rng() % 64;
+                    uint32_t value = randomValue(rng);
+                    ref.write(r, value);
+                    alt.write(r, value);
+                }
+                // Mostly existing opcodes, with random sf, lm and MVMVA bits
+                uint32_t opcode = rng() % 8 ? opcodes[rng() % (sizeof(opcodes) / sizeof(opcodes[0]))].cmd : rng() % 64;
+                gte::Command cmd((rng() & 0x1ffffc0) | opcode);
+                commands.push_back(cmd._reg);
+                bool valid = reference(ref, cmd);
+                if (impl.command(alt, cmd) != valid) {
+                    if (mismatches++ < 10) printf("%s: command %08x validity differs\n", impl.name, cmd._reg);
+                }
+                if (valid) executed++;
+            }
+
+            for (int r = 0; r < 64; r++) {
+                uint32_t expected = ref.read(r), actual = alt.read(r);
+                if (expected == actual) continue;
+                if (mismatches++ < 10) {
+                    printf("%s: register %d is %08x, expected %08x after", impl.name, r, actual, expected);
+                    for (uint32_t cmd : commands) printf(" %08x", cmd);
+                    printf("\n");
+                }
+                break;
+            }
+        }
+        printf("%-12s %8d commands, %d mismatches\n", impl.name, executed, mismatches);
+        if (mismatches != 0) failed++;
+    }
+    return failed != 0 ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    int iterations = 200000;
+    bool readFlag = false;
+    int fuzzCases = 0;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            iterations = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--flag") == 0) {
+            readFlag = true;
+        } else if (strcmp(argv[i], "--fuzz") == 0 && i + 1 < argc) {
+            fuzzCases = std::max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) {
+            seed = strtoul(argv[++i], nullptr, 0);
+        } else {
+            printHelp();
+            return 0;
+        }
+    }
+
+    if (fuzzCases > 0) return fuzz(fuzzCases, seed);
+    return benchmark(iterations, readFlag);
+}
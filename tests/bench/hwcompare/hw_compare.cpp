@@ -0,0 +1,209 @@
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+#include "device/gpu/gpu.h"
+#include "renderer/opengl/hardware_renderer.h"
+#include "utils/file.h"
+
+void printHelp() {
+    printf(R"(
+usage: avocado_hwcompare [options] capture.gpulog [capture2.gpulog ...]
+Replays captures with software and hardware renderer (headless EGL context) and compares resulting VRAM.
+Must be run from repository root (shaders are loaded from data/shader).
+  --tolerance N  - allowed difference of single color channel (default 1)
+  --max-diff P   - maximum percentage of mismatched pixels in drawn area (default 1.0)
+  --help         - print help
+)");
+}
+
+// Headless OpenGL 3.2 core context, surfaceless if supported, otherwise with 1x1 pbuffer
+class EglContext {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+
+   public:
+    ~EglContext() {
+        if (display == EGL_NO_DISPLAY) return;
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+        if (context != EGL_NO_CONTEXT) eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+
+    bool create() {
+        // Mesa can create context without any window system
+        const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (clientExtensions != nullptr && strstr(clientExtensions, "EGL_MESA_platform_surfaceless") != nullptr) {
+            display = eglGetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            printf("Cannot initialize EGL display\n");
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            printf("EGL: OpenGL API is not supported\n");
+            return false;
+        }
+
+        const EGLint configAttribs[] = {EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+        EGLConfig config;
+        EGLint configCount = 0;
+        if (!eglChooseConfig(display, configAttribs, &config, 1, &configCount) || configCount == 0) {
+            printf("EGL: no suitable config\n");
+            return false;
+        }
+
+        const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 2, EGL_CONTEXT_OPENGL_PROFILE_MASK,
+                                         EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT, EGL_NONE};
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+        if (context == EGL_NO_CONTEXT) {
+            printf("EGL: cannot create OpenGL 3.2 core context\n");
+            return false;
+        }
+
+        // Rendering goes to VRAM framebuffer, surface is only needed to make context current
+        const char* extensions = eglQueryString(display, EGL_EXTENSIONS);
+        if (extensions == nullptr || strstr(extensions, "EGL_KHR_surfaceless_context") == nullptr) {
+            const EGLint surfaceAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+            surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+        }
+        if (!eglMakeCurrent(display, surface, surface, context)) {
+            printf("EGL: cannot make context current\n");
+            return false;
+        }
+
+        if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+            printf("Cannot load OpenGL functions\n");
+            return false;
+        }
+        return true;
+    }
+};
+
+// GP0 words rebuilt from capture log, CPU to VRAM transfers are skipped (data is not logged)
+std::vector<uint32_t> replayWords(const CommandLog& log) {
+    std::vector<uint32_t> words;
+    for (size_t i = 0; i < log.size(); i++) {
+        auto e = log[i];
+        if (e.cmd == Command::CopyCpuToVram1 || e.argCount == 0) continue;
+        words.push_back(e.args[0] | (e.command << 24));
+        words.insert(words.end(), e.args + 1, e.args + e.argCount);
+    }
+    return words;
+}
+
+struct Difference {
+    int pixels = 0;    // Pixels with any channel over tolerance
+    int drawn = 0;     // Pixels changed by any of renderers
+    int maxDelta = 0;  // Largest channel difference
+    Rect<int> area;    // Bounding box of mismatched pixels
+};
+
+// Only pixels drawn by at least one of renderers are counted
+Difference compareVram(const std::vector<uint16_t>& start, const std::vector<uint16_t>& sw, const std::vector<uint16_t>& hw,
+                       int tolerance) {
+    Difference diff;
+    diff.area = {VRAM_WIDTH, VRAM_HEIGHT, 0, 0};
+    for (int y = 0; y < VRAM_HEIGHT; y++) {
+        for (int x = 0; x < VRAM_WIDTH; x++) {
+            int i = y * VRAM_WIDTH + x;
+            if (sw[i] == start[i] && hw[i] == start[i]) continue;
+            diff.drawn++;
+
+            int delta = 0;
+            for (int shift : {0, 5, 10}) {
+                delta = std::max(delta, std::abs(((sw[i] >> shift) & 0x1f) - ((hw[i] >> shift) & 0x1f)));
+            }
+            if ((sw[i] & 0x8000) != (hw[i] & 0x8000)) delta = std::max(delta, 0x1f);
+            diff.maxDelta = std::max(diff.maxDelta, delta);
+            if (delta <= tolerance) continue;
+
+            diff.pixels++;
+            diff.area.left = std::min(diff.area.left, x);
+            diff.area.top = std::min(diff.area.top, y);
+            diff.area.right = std::max(diff.area.right, x);
+            diff.area.bottom = std::max(diff.area.bottom, y);
+        }
+    }
+    return diff;
+}
+
+int main(int argc, char** argv) {
+    int tolerance = 1;
+    double maxDiff = 1.0;
+    std::vector<std::string> files;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--max-diff") == 0 && i + 1 < argc) {
+            maxDiff = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--help") == 0) {
+            printHelp();
+            return 0;
+        } else {
+            files.push_back(argv[i]);
+        }
+    }
+
+    if (files.empty()) {
+        printHelp();
+        return 0;
+    }
+
+    EglContext egl;
+    if (!egl.create()) return 1;
+    printf("OpenGL: %s, %s\n", glGetString(GL_VERSION), glGetString(GL_RENDERER));
+
+    HardwareRenderer renderer;
+    if (!renderer.setup()) return 1;
+
+    int failed = 0;
+    for (auto& file : files) {
+        // Hardware renderer works on native resolution VRAM
+        auto software = std::make_unique<GPU>();
+        auto hardware = std::make_unique<GPU>();
+        software->setResolutionMultiplier(1);
+        hardware->setResolutionMultiplier(1);
+        if (!fileExists(file) || !software->loadLogCapture(file) || !hardware->loadLogCapture(file)) {
+            printf("Cannot load capture %s\n", file.c_str());
+            return 1;
+        }
+        software->gpuLogEnabled = false;
+        hardware->gpuLogEnabled = false;
+
+        std::vector<uint32_t> words = replayWords(software->gpuLog);
+        std::vector<uint16_t> start = software->vram;
+
+        software->restoreFrameStart();
+        for (uint32_t word : words) software->writeGP0(word);
+        software->flushDeferred();
+
+        hardware->restoreFrameStart();
+        renderer.attach(hardware.get());
+        for (uint32_t word : words) hardware->writeGP0(word);
+        renderer.detach();
+
+        Difference diff = compareVram(start, software->vram, hardware->vram, tolerance);
+        double percent = diff.drawn > 0 ? 100.0 * diff.pixels / diff.drawn : 0.0;
+        bool ok = percent <= maxDiff;
+
+        printf("%s: %zu words, %d pixels drawn, %d mismatched (%.3f%%), max channel delta %d", file.c_str(), words.size(), diff.drawn,
+               diff.pixels, percent, diff.maxDelta);
+        if (diff.pixels > 0) {
+            printf(", area %d,%d - %d,%d", diff.area.left, diff.area.top, diff.area.right, diff.area.bottom);
+        }
+        printf(" - %s\n", ok ? "OK" : "FAIL");
+        if (!ok) failed++;
+    }
+
+    return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+#include <catch.hpp>
+#include "device/gpu/gpu.h"
+
+namespace {
+// Draws semi-transparent flat triangle with 8,8,8 color over 16,16,16 background
+uint16_t blendUntextured(int mode) {
+    GPU gpu;
+    gpu.writeGP1(0x00000000);
+    gpu.writeGP0(0xe3000000);                       // Drawing area top left
+    gpu.writeGP0(0xe4000000 | (511 << 10) | 1023);  // Drawing area bottom right
+    gpu.writeGP0(0x02808080);                       // Fill rectangle
+    gpu.writeGP0(0x00000000);
+    gpu.writeGP0((16 << 16) | 16);
+    gpu.writeGP0(0xe1000000 | (mode << 5));         // Draw mode, semi transparency
+    gpu.writeGP0(0x22404040);                       // Monochrome semi-transparent triangle
+    gpu.writeGP0(0x00000000);
+    gpu.writeGP0(16);
+    gpu.writeGP0(16 << 16);
+    return gpu.readVram(1, 1);
+}
+
+uint16_t gray(int c) { return c | (c << 5) | (c << 10); }
+}  // namespace
+
+TEST_CASE("Untextured semi-transparent polygon uses blending mode from GP0(E1)", "[gpu]") {
+    REQUIRE(blendUntextured(0) == gray(12));  // B/2 + F/2
+    REQUIRE(blendUntextured(1) == gray(24));  // B + F
+    REQUIRE(blendUntextured(2) == gray(8));   // B - F
+    REQUIRE(blendUntextured(3) == gray(18));  // B + F/4
+}
@@ -0,0 +1,82 @@
+#include "device/gpu/display.h"
+#include "device/gpu/gpu.h"
+#include <catch.hpp>
+#include <vector>
+
+namespace {
+uint32_t expand5(uint32_t c) { return (c << 3) | (c >> 2); }
+
+uint32_t expected15(uint16_t p) { return expand5(p & 0x1f) | expand5((p >> 5) & 0x1f) << 8 | expand5((p >> 10) & 0x1f) << 16 | 0xff000000; }
+}  // namespace
+
+TEST_CASE("15bpp display row is expanded to 8 bit channels", "[display]") {
+    // Odd length covers both vectorized and scalar part
+    std::vector<uint16_t> src = {0x0000, 0x7fff, 0xffff, 0x001f, 0x03e0, 0x7c00, 0x8421, 0x1234, 0x4210, 0x2108, 0x56ab};
+    std::vector<uint32_t> dst(src.size());
+    convert15to32(src.data(), dst.data(), (int)src.size());
+
+    REQUIRE(dst[0] == 0xff000000);
+    REQUIRE(dst[1] == 0xffffffff);
+    REQUIRE(dst[2] == 0xffffffff);  // Mask bit is ignored
+    REQUIRE(dst[3] == 0xff0000ff);
+    REQUIRE(dst[4] == 0xff00ff00);
+    REQUIRE(dst[5] == 0xffff0000);
+    for (size_t i = 0; i < src.size(); i++) {
+        INFO("pixel " << i);
+        REQUIRE(dst[i] == expected15(src[i]));
+    }
+}
+
+TEST_CASE("24bpp display row is read as packed RGB bytes", "[display]") {
+    // Pixels span halfword boundaries, second one starts in the middle of halfword
+    const uint8_t src[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0xff, 0x00, 0x80, 0xaa};
+    uint32_t dst[3];
+    convert24to32(src, dst, 3);
+
+    REQUIRE(dst[0] == 0xff332211);
+    REQUIRE(dst[1] == 0xff665544);
+    REQUIRE(dst[2] == 0xff8000ff);
+}
+
+TEST_CASE("Display area is decoded from VRAM", "[display]") {
+    GPU gpu;
+    gpu.writeGP1(0x00000000);  // Reset, display is disabled
+    std::vector<uint32_t> rgba;
+    int width, height;
+
+    SECTION("disabled display is not decoded") {
+        REQUIRE_FALSE(decodeDisplay(&gpu, rgba, width, height));
+    }
+
+    SECTION("15bpp") {
+        gpu.writeGP1(0x03000000);                     // Display enable
+        gpu.writeGP1(0x05000000 | (240 << 10) | 16);  // Start at 16,240
+        gpu.writeGP1(0x08000000);                     // 256x240, 15bpp
+        gpu.writeVram(16, 240, 0x001f);
+        gpu.writeVram(16 + 255, 240 + 239, 0x7c00);
+        gpu.writeVram(15, 240, 0x7fff);  // Outside of display area
+
+        REQUIRE(decodeDisplay(&gpu, rgba, width, height));
+        REQUIRE(width == 256);
+        REQUIRE(height == 240);
+        REQUIRE(rgba.size() == 256u * 240u);
+        REQUIRE(rgba[0] == 0xff0000ff);
+        REQUIRE(rgba[1] == 0xff000000);
+        REQUIRE(rgba.back() == 0xffff0000);
+    }
+
+    SECTION("24bpp") {
+        gpu.writeGP1(0x03000000);
+        gpu.writeGP1(0x05000000 | 100);
+        gpu.writeGP1(0x08000000 | (1 << 4) | 1);  // 320x240, 24bpp
+        // Two pixels packed in three halfwords
+        gpu.writeVram(100, 0, 0x2211);
+        gpu.writeVram(101, 0, 0x4433);
+        gpu.writeVram(102, 0, 0x6655);
+
+        REQUIRE(decodeDisplay(&gpu, rgba, width, height));
+        REQUIRE(width == 320);
+        REQUIRE(rgba[0] == 0xff332211);
+        REQUIRE(rgba[1] == 0xff665544);
+    }
+}
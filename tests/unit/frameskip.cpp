@@ -0,0 +1,129 @@
+#include <catch.hpp>
+#include <random>
+#include <vector>
+#include "device/gpu/gpu.h"
+
+namespace {
+// Same GP0 stream is sent to GPU drawing everything and to one which defers primitives (frame skipping)
+struct GpuPair {
+    GPU normal, skipping;
+
+    GpuPair() { skipping.skipRendering = true; }
+
+    void write(const std::vector<uint32_t>& words) {
+        for (uint32_t word : words) {
+            normal.writeGP0(word);
+            skipping.writeGP0(word);
+        }
+    }
+
+    // Number of mismatched words read back from VRAM
+    int readback(int words) {
+        int mismatches = 0;
+        for (int i = 0; i < words; i++) {
+            if (normal.read(0) != skipping.read(0)) mismatches++;
+        }
+        return mismatches;
+    }
+
+    bool vramEqual() {
+        skipping.flushDeferred();
+        return normal.vram == skipping.vram;
+    }
+};
+
+uint32_t xy(int x, int y) { return (y & 0xffff) << 16 | (x & 0xffff); }
+
+// Random GP0 packets limited to small part of VRAM, so that primitives, textures and transfers overlap
+struct StreamGenerator {
+    std::mt19937 rng;
+
+    explicit StreamGenerator(uint32_t seed) : rng(seed) {}
+
+    uint32_t next() { return static_cast<uint32_t>(rng()); }
+    int coord(int max) { return next() % max; }
+    uint32_t color() { return next() & 0xffffff; }
+    uint32_t vertex() { return xy(coord(384), coord(256)); }
+    uint32_t uv(uint16_t attribute) { return attribute << 16 | (next() & 0xffff); }
+    uint16_t clut() { return (200 + coord(56)) << 6 | coord(64); }  // CLUT X is in 16 halfword units
+    uint16_t texpage() { return next() & 0x9ef; }                    // Texture pages in top row
+
+    std::vector<uint32_t> packet(int& readbackWords) {
+        readbackWords = 0;
+        uint32_t cmd;
+        switch (next() % 12) {
+            case 0: return {0x02000000 | color(), xy(coord(24) * 16, coord(256)), xy(16 + coord(12) * 16, 1 + coord(128))};
+            case 1: return {0x20000000 | color(), vertex(), vertex(), vertex()};
+            case 2:
+                cmd = next() % 2 ? 0x2c : 0x2e;
+                return {cmd << 24 | color(), vertex(), uv(clut()), vertex(), uv(texpage()), vertex(), uv(0), vertex(), uv(0)};
+            case 3: return {0x32000000 | color(), vertex(), color(), vertex(), color(), vertex()};
+            case 4: return {0x64000000 | color(), vertex(), uv(clut()), xy(1 + coord(64), 1 + coord(64))};
+            case 5: return {0x62000000 | color(), vertex(), xy(1 + coord(128), 1 + coord(128))};
+            case 6: return {0x40000000 | color(), vertex(), vertex()};
+            case 7: return {0x80000000, vertex(), vertex(), xy(1 + coord(64), 1 + coord(64))};
+            case 8: {
+                int w = 1 + coord(32), h = 1 + coord(32);
+                std::vector<uint32_t> words = {0xa0000000, vertex(), xy(w, h)};
+                for (int i = 0; i < (w * h + 1) / 2; i++) words.push_back(next());
+                return words;
+            }
+            case 9: {
+                int w = 1 + coord(32), h = 1 + coord(32);
+                readbackWords = (w * h + 1) / 2;
+                return {0xc0000000, vertex(), xy(w, h)};
+            }
+            case 10: return {0xe1000000 | texpage() | (next() & 0x600)};
+            default: {
+                // New drawing area and offset
+                int x = coord(256), y = coord(192);
+                return {0xe3000000 | (y << 10) | x, 0xe4000000 | ((y + 1 + coord(128)) << 10) | (x + 1 + coord(256)),
+                        0xe5000000 | (coord(64) << 11) | coord(64)};
+            }
+        }
+    }
+};
+}  // namespace
+
+TEST_CASE("Frame skipping produces same VRAM and readback for random streams", "[frameskip]") {
+    for (uint32_t seed = 1; seed <= 20; seed++) {
+        GpuPair gpu;
+        StreamGenerator gen(seed);
+        gpu.write({0xe3000000, 0xe4000000 | (511 << 10) | 1023, 0xe5000000});
+
+        int mismatches = 0;
+        for (int i = 0; i < 300; i++) {
+            int readbackWords;
+            gpu.write(gen.packet(readbackWords));
+            mismatches += gpu.readback(readbackWords);
+        }
+
+        INFO("seed " << seed);
+        REQUIRE(mismatches == 0);
+        REQUIRE(gpu.vramEqual());
+    }
+}
+
+TEST_CASE("Frame skipping handles double buffered scene with render to texture", "[frameskip]") {
+    GpuPair gpu;
+    for (int frame = 0; frame < 6; frame++) {
+        int buffer = (frame % 2) * 256;  // Back buffer X
+
+        // Offscreen texture at (512, 0), sampled as 16bit texture page 8
+        gpu.write({0xe3000000 | 512, 0xe4000000 | (63 << 10) | 575, 0xe5000000 | 512});
+        gpu.write({0x02000000 | (0x100010u * frame), xy(512, 0), xy(64, 64)});
+        gpu.write({0x20000000 | 0x00ff00, xy(0, 0), xy(63, 10 * frame), xy(10, 63)});
+
+        // Clear back buffer and draw textured sprite and quad sampling offscreen texture
+        gpu.write({0xe3000000 | buffer, 0xe4000000 | (239 << 10) | (buffer + 255), 0xe5000000 | buffer});
+        gpu.write({0x02000000 | 0x202020, xy(buffer, 0), xy(256, 240)});
+        gpu.write({0xe1000000 | 0x108});
+        gpu.write({0x65808080, xy(20 + frame, 30), 0, xy(64, 64)});
+        gpu.write({0x2c808080, xy(100, 100), 0, xy(200, 100), 0x108u << 16 | 63, xy(100, 200), 63u << 8, xy(200, 200), 0x3f3f});
+
+        // Copy part of the frame to another place (eg. motion blur buffer)
+        gpu.write({0x80000000, xy(buffer, 0), xy(768, 256), xy(128, 128)});
+    }
+
+    REQUIRE(gpu.vramEqual());
+}
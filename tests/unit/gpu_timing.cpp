@@ -0,0 +1,29 @@
+#include <catch.hpp>
+#include "device/gpu/gpu.h"
+
+TEST_CASE("GPU clock runs at 11/7 of CPU clock", "[gpu]") {
+    GPU gpu;
+    gpu.writeGP1(0x00000000);
+
+    SECTION("fraction of cycle is not lost") {
+        int start = gpu.timing.cycle;
+        for (int i = 0; i < 7; i++) gpu.emulateGpuCycles(1);
+        REQUIRE(gpu.timing.cycle - start == 11);
+    }
+
+    SECTION("NTSC frame takes 263 lines of 3413 GPU cycles") {
+        const int step = 300;
+        auto nextVblank = [&]() {
+            int cycles = 0;
+            do {
+                cycles += step;
+            } while (!gpu.emulateGpuCycles(step));
+            return cycles;
+        };
+
+        nextVblank();
+        int cpuCycles = nextVblank();
+        int expected = VideoTiming::LINES_NTSC * VideoTiming::CYCLES_PER_LINE_NTSC * 7 / 11;
+        REQUIRE(std::abs(cpuCycles - expected) <= step);
+    }
+}
@@ -0,0 +1,138 @@
+#include <system.h>
+#include <algorithm>
+#include <catch.hpp>
+#include <limits>
+#include <vector>
+
+namespace {
+// Timer 2 registers, counting system clock / 3 unless mode selects / 8
+const uint32_t COUNTER = 0x1f801120;
+const uint32_t MODE = 0x1f801124;
+const uint32_t TARGET = 0x1f801128;
+const uint32_t ISTAT = 0x1f801070;
+
+const uint32_t RESET_AT_TARGET = 1 << 3;
+const uint32_t IRQ_AT_TARGET = 1 << 4;
+const uint32_t IRQ_AT_FFFF = 1 << 5;
+const uint32_t IRQ_REPEAT = 1 << 6;
+const uint32_t IRQ_TOGGLE = 1 << 7;
+const uint32_t IRQ_REQUEST = 1 << 10;
+const uint32_t REACHED_TARGET = 1 << 11;
+const uint32_t REACHED_FFFF = 1 << 12;
+
+std::unique_ptr<System> setup(uint32_t mode, uint32_t target) {
+    auto sys = std::make_unique<System>();
+    sys->writeMemory32(TARGET, target);
+    sys->writeMemory32(MODE, mode);
+    sys->writeMemory32(ISTAT, 0);
+    return sys;
+}
+
+// Runs like System::emulateFrame does, timer is only stepped when its event is due
+int runTicks(System* sys, uint64_t ticks) {
+    int irqs = 0;
+    uint64_t end = sys->cycles + ticks * 3;
+    while (sys->cycles < end) {
+        sys->cycles = std::min(end, sys->timer2->nextEvent());
+        sys->timer2->step();
+        if (sys->readMemory32(ISTAT) & (1 << interrupt::TIMER2)) {
+            irqs++;
+            sys->writeMemory32(ISTAT, ~(1u << interrupt::TIMER2));
+        }
+    }
+    return irqs;
+}
+}  // namespace
+
+TEST_CASE("Timer skips whole periods in one update", "[timer]") {
+    auto sys = setup(RESET_AT_TARGET, 10);
+
+    sys->cycles += 3 * (10 * 100000 + 7);
+    REQUIRE(sys->readMemory16(COUNTER) == 7);
+    REQUIRE(sys->readMemory32(MODE) & REACHED_TARGET);
+    REQUIRE_FALSE(sys->readMemory32(MODE) & REACHED_TARGET);  // Cleared by read
+}
+
+TEST_CASE("Timer sets reached target and FFFF flags", "[timer]") {
+    auto sys = setup(0, 0x100);
+
+    sys->cycles += 3 * 0x80;
+    uint32_t mode = sys->readMemory32(MODE);
+    REQUIRE_FALSE(mode & REACHED_TARGET);
+    REQUIRE_FALSE(mode & REACHED_FFFF);
+
+    sys->cycles += 3 * 0x80;
+    mode = sys->readMemory32(MODE);
+    REQUIRE(mode & REACHED_TARGET);
+    REQUIRE_FALSE(mode & REACHED_FFFF);
+
+    // Counter wraps to 0 after 0xffff
+    sys->cycles += 3 * (0xffff - 0x100);
+    REQUIRE(sys->readMemory16(COUNTER) == 0);
+    mode = sys->readMemory32(MODE);
+    REQUIRE_FALSE(mode & REACHED_TARGET);
+    REQUIRE(mode & REACHED_FFFF);
+}
+
+TEST_CASE("Timer in toggle mode raises IRQ every second event", "[timer]") {
+    auto sys = setup(RESET_AT_TARGET | IRQ_AT_TARGET | IRQ_REPEAT | IRQ_TOGGLE, 100);
+    REQUIRE(sys->readMemory32(MODE) & IRQ_REQUEST);
+
+    REQUIRE(runTicks(sys.get(), 100) == 1);
+    REQUIRE_FALSE(sys->readMemory32(MODE) & IRQ_REQUEST);
+    REQUIRE(runTicks(sys.get(), 100) == 0);
+    REQUIRE(sys->readMemory32(MODE) & IRQ_REQUEST);
+    REQUIRE(runTicks(sys.get(), 600) == 3);
+}
+
+TEST_CASE("Timer in one-shot mode raises IRQ once until mode is written", "[timer]") {
+    auto sys = setup(RESET_AT_TARGET | IRQ_AT_TARGET, 100);
+
+    REQUIRE(runTicks(sys.get(), 1000) == 1);
+    REQUIRE(sys->timer2->nextEvent() == std::numeric_limits<uint64_t>::max());
+
+    sys->writeMemory32(MODE, RESET_AT_TARGET | IRQ_AT_TARGET);
+    REQUIRE(runTicks(sys.get(), 1000) == 1);
+}
+
+TEST_CASE("Timer deadline matches stepping every cycle", "[timer]") {
+    const uint32_t modes[] = {
+        IRQ_AT_TARGET | IRQ_REPEAT,
+        RESET_AT_TARGET | IRQ_AT_TARGET | IRQ_REPEAT,
+        RESET_AT_TARGET | IRQ_AT_TARGET | IRQ_REPEAT | IRQ_TOGGLE | (1 << 9),  // System clock / 8
+        IRQ_AT_FFFF | IRQ_REPEAT,
+        IRQ_AT_TARGET | IRQ_AT_FFFF | IRQ_REPEAT,
+    };
+    const uint32_t targets[] = {0, 1, 0x7f, 0xffff};
+
+    for (uint32_t mode : modes) {
+        for (uint32_t target : targets) {
+            auto predicted = setup(mode, target);
+            auto stepped = setup(mode, target);
+
+            // Cycles at which IRQs were raised
+            std::vector<uint64_t> expected, actual;
+            const uint64_t end = ((mode & (1 << 9)) ? 24 : 3) * 0x30000ull;  // Few wraps of the counter
+            while (stepped->cycles < end) {
+                stepped->cycles++;
+                stepped->timer2->step();
+                if (stepped->readMemory32(ISTAT) & (1 << interrupt::TIMER2)) {
+                    expected.push_back(stepped->cycles);
+                    stepped->writeMemory32(ISTAT, 0);
+                }
+            }
+            while (predicted->timer2->nextEvent() <= end) {
+                predicted->cycles = predicted->timer2->nextEvent();
+                predicted->timer2->step();
+                if (predicted->readMemory32(ISTAT) & (1 << interrupt::TIMER2)) {
+                    actual.push_back(predicted->cycles);
+                    predicted->writeMemory32(ISTAT, 0);
+                }
+            }
+
+            INFO("mode " << mode << " target " << target);
+            REQUIRE_FALSE(expected.empty());
+            REQUIRE(actual == expected);
+        }
+    }
+}
@@ -0,0 +1,28 @@
+#include "utils/fifo.h"
+#include <catch.hpp>
+
+TEST_CASE("Fifo keeps insertion order across wrap", "[fifo]") {
+    Fifo<uint8_t, 4> fifo;
+    for (int i = 0; i < 3; i++) fifo.push(i);
+    REQUIRE(fifo.pop() == 0);
+    REQUIRE(fifo.pop() == 1);
+    fifo.push(3);
+    fifo.push(4);
+    fifo.push(5);
+    REQUIRE(fifo.full());
+    REQUIRE(fifo[0] == 2);
+    REQUIRE(fifo.back() == 5);
+    for (int i = 2; i <= 5; i++) REQUIRE(fifo.pop() == i);
+    REQUIRE(fifo.empty());
+}
+
+TEST_CASE("Fifo drops values pushed when full", "[fifo]") {
+    Fifo<uint8_t, 2> fifo;
+    REQUIRE(fifo.push(1));
+    REQUIRE(fifo.push(2));
+    REQUIRE_FALSE(fifo.push(3));
+    REQUIRE(fifo.size() == 2);
+    REQUIRE(fifo.pop() == 1);
+    REQUIRE(fifo.pop() == 2);
+    REQUIRE(fifo.pop() == 0);  // Empty
+}